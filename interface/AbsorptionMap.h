@@ -0,0 +1,99 @@
+#ifndef ABSORPTION_MAP_H
+#define ABSORPTION_MAP_H
+
+#include <vector>
+#include <algorithm>
+
+#include "BinarySerialization.h"
+
+// Grid of absorption counts over the start conditions: start x in [minX, maxX) and the uniform [0, 1)
+// sample of the z velocity. Cells where all of at least minAttempts integrated attempts were absorbed are
+// predicted to absorb: start conditions falling there can skip the integration. A cell is rarely absorbing
+// everywhere, so skipping them all would bias the result; the users keep integrating a fraction of them with
+// an inverse probability weight, and those attempts keep updating the counts: a predicted cell with a hit
+// is no longer predicted to absorb.
+class AbsorptionMap
+{
+	public:
+		struct Attempt
+		{
+			float x;
+			float zVelocitySample;
+			bool  absorbed;
+		};
+	private:
+		int                    numXCells;
+		int                    numZCells;
+		double                 minX;
+		double                 maxX;
+		int                    minAttempts;
+		std::vector<long long> numAttempts;
+		std::vector<long long> numAbsorbed;
+		std::vector<char>      predictedAbsorbing;
+		int cell(const double& x, const double& zVelocitySample) const
+		{
+			const int xCell = std::min(numXCells - 1, std::max(0, static_cast<int>((x - minX) / (maxX - minX) * numXCells)));
+			const int zCell = std::min(numZCells - 1, std::max(0, static_cast<int>(zVelocitySample * numZCells)));
+			return zCell * numXCells + xCell;
+		}
+	public:
+		AbsorptionMap(const int& numXCellsArg, const int& numZCellsArg, const double& minXArg, const double& maxXArg, const int& minAttemptsArg):
+			numXCells(numXCellsArg), numZCells(numZCellsArg), minX(minXArg), maxX(maxXArg), minAttempts(minAttemptsArg),
+			numAttempts(numXCellsArg * numZCellsArg, 0), numAbsorbed(numXCellsArg * numZCellsArg, 0), predictedAbsorbing(numXCellsArg * numZCellsArg, 0) {}
+		void record(const Attempt& attempt)
+		{
+			const int index = cell(attempt.x, attempt.zVelocitySample);
+			numAttempts[index]++;
+			numAbsorbed[index] += attempt.absorbed;
+		}
+		void record(const std::vector<Attempt>& attempts)
+		{
+			for(const auto& attempt: attempts) record(attempt);
+		}
+		bool isPredictedAbsorbing(const double& x, const double& zVelocitySample) const
+		{
+			return predictedAbsorbing[cell(x, zVelocitySample)];
+		}
+		// Called between rounds, when no thread reads the prediction. Never predicts the whole grid to absorb.
+		void updatePrediction()
+		{
+			std::vector<char> prediction(predictedAbsorbing.size(), 0);
+			for(unsigned int index = 0; index < prediction.size(); ++index)
+			{
+				prediction[index] = minAttempts <= numAttempts[index] && numAbsorbed[index] == numAttempts[index];
+			}
+			if(std::find(prediction.begin(), prediction.end(), 0) != prediction.end()) predictedAbsorbing = prediction;
+		}
+		// Counts and prediction (e.g. for checkpoints), read() expects a map of the same grid
+		void write(std::ostream& stream) const
+		{
+			writeValues(stream, numAttempts);
+			writeValues(stream, numAbsorbed);
+			writeValues(stream, predictedAbsorbing);
+		}
+		bool read(std::istream& stream)
+		{
+			const std::size_t numCells = numAttempts.size();
+			return readValues(stream, numAttempts) && readValues(stream, numAbsorbed) && readValues(stream, predictedAbsorbing) &&
+				numAttempts.size() == numCells && numAbsorbed.size() == numCells && predictedAbsorbing.size() == numCells;
+		}
+		// Fraction of the start condition space predicted to absorb
+		double getPredictedAbsorbingVolume() const
+		{
+			return std::count(predictedAbsorbing.begin(), predictedAbsorbing.end(), 1) / static_cast<double>(predictedAbsorbing.size());
+		}
+		// Absorbed fraction of uniformly drawn start conditions: predicted cells count as absorbing, the others
+		// with their measured absorbed fraction (cells without attempts as not absorbing)
+		double estimateAbsorbedFraction() const
+		{
+			double fraction = 0.0;
+			for(unsigned int index = 0; index < numAttempts.size(); ++index)
+			{
+				if(predictedAbsorbing[index])     fraction += 1.0;
+				else if(0 < numAttempts[index])   fraction += numAbsorbed[index] / static_cast<double>(numAttempts[index]);
+			}
+			return fraction / numAttempts.size();
+		}
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef ADAPTIVE_HIT_MAP_H
+#define ADAPTIVE_HIT_MAP_H
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+
+#include "HistogramAccumulator.h"
+
+// Piecewise linear map from the start x to the hit x of a deterministic experiment, refined adaptively.
+// An interval is bisected while it is wider than minStartXStep and
+//  - its ends hit more than maxHitStep apart (steep parts of the map),
+//  - its slope has the opposite sign of a neighbouring interval (folds of the map: rainbow caustics of the hit density),
+//  - or exactly one of its ends is absorbed.
+// Intervals lying completely below hitMin or above hitMax are not refined, their weight goes to the under/overflow.
+class AdaptiveHitMap
+{
+	public:
+		struct Node
+		{
+			double startX;
+			double hitX;
+			bool   absorbed;
+		};
+		// Calculates hitX and absorbed of the given nodes (e.g. in parallel)
+		using Evaluator = std::function<void(std::vector<Node>& nodes)>;
+	private:
+		std::vector<Node> nodes;
+		double            minStartXStep;
+		double            maxHitStep;
+		double            hitMin;
+		double            hitMax;
+		int               numUnresolved = 0;
+		double slope(const int& interval) const { return nodes[interval + 1].hitX - nodes[interval].hitX; }
+		// Refinement priority of an interval, 0 if it is resolved
+		double refinementPriority(const int& interval) const
+		{
+			const Node& left  = nodes[interval];
+			const Node& right = nodes[interval + 1];
+			if(left.absorbed != right.absorbed) return 1.0;
+			if(left.absorbed) return 0.0;
+			if((left.hitX < hitMin && right.hitX < hitMin) || (hitMax < left.hitX && hitMax < right.hitX)) return 0.0;
+			const double hitStep = std::abs(slope(interval));
+			bool fold = false;
+			for(int neighbour = interval - 1; neighbour <= interval + 1; neighbour += 2)
+			{
+				if(neighbour < 0 || static_cast<int>(nodes.size()) - 1 <= neighbour) continue;
+				if(nodes[neighbour].absorbed || nodes[neighbour + 1].absorbed) continue;
+				fold = fold || slope(interval) * slope(neighbour) < 0.0;
+			}
+			if(maxHitStep < hitStep) return hitStep / maxHitStep;
+			return fold ? 1.0 : 0.0;
+		}
+	public:
+		AdaptiveHitMap(const double& minStartXStepArg, const double& maxHitStepArg, const double& hitMinArg, const double& hitMaxArg):
+			minStartXStep(minStartXStepArg), maxHitStep(maxHitStepArg), hitMin(hitMinArg), hitMax(hitMaxArg) {}
+		int getNumNodes()      const { return nodes.size(); }
+		// Intervals that still need refinement but reached minStartXStep or the node limit
+		int getNumUnresolved() const { return numUnresolved; }
+		const std::vector<Node>& getNodes() const { return nodes; }
+		// Starts from numInitialNodes equidistant nodes on [minX, maxX], then bisects the intervals of the highest
+		// priority pass by pass until every interval is resolved or maxNodes is reached. Returns the number of passes.
+		int build(const double& minX, const double& maxX, const int& numInitialNodes, const int& maxNodes, const Evaluator& evaluate)
+		{
+			nodes.clear();
+			for(int nodeIndex = 0; nodeIndex < numInitialNodes; ++nodeIndex)
+			{
+				nodes.push_back(Node{minX + (maxX - minX) * nodeIndex / (numInitialNodes - 1), 0.0, false});
+			}
+			evaluate(nodes);
+			int numPasses = 1;
+			while(true)
+			{
+				std::vector<std::pair<double, int>> candidates;
+				numUnresolved = 0;
+				for(int interval = 0; interval < static_cast<int>(nodes.size()) - 1; ++interval)
+				{
+					const double priority = refinementPriority(interval);
+					if(priority <= 0.0) continue;
+					if(nodes[interval + 1].startX - nodes[interval].startX < 2.0 * minStartXStep)
+					{
+						++numUnresolved;
+						continue;
+					}
+					candidates.emplace_back(priority, interval);
+				}
+				const int numNewNodes = std::min<int>(candidates.size(), maxNodes - nodes.size());
+				if(numNewNodes <= 0)
+				{
+					numUnresolved += candidates.size();
+					break;
+				}
+				numUnresolved += candidates.size() - numNewNodes;
+				std::partial_sort(candidates.begin(), candidates.begin() + numNewNodes, candidates.end(),
+					[] (const std::pair<double, int>& lhs, const std::pair<double, int>& rhs) { return lhs.first > rhs.first; });
+				std::vector<Node> newNodes;
+				for(int candidate = 0; candidate < numNewNodes; ++candidate)
+				{
+					const int interval = candidates[candidate].second;
+					newNodes.push_back(Node{0.5 * (nodes[interval].startX + nodes[interval + 1].startX), 0.0, false});
+				}
+				evaluate(newNodes);
+				nodes.insert(nodes.end(), newNodes.begin(), newNodes.end());
+				std::sort(nodes.begin(), nodes.end(), [] (const Node& lhs, const Node& rhs) { return lhs.startX < rhs.startX; });
+				++numPasses;
+			}
+			return numPasses;
+		}
+		// Hit histogram of a uniform start x pushed through the piecewise linear map: a linear piece spreads its
+		// weight evenly over its image, so the histogram is integrated exactly instead of sampled. Pieces still
+		// steeper than maxHitStep are unresolved jumps of the map (chaotic scattering), spreading them would fill
+		// the gap between the two hits, so half of their weight goes to each end instead. Absorbed ends carry no
+		// weight (absorbed experiments are repeated in the Monte Carlo runs), the result is normalized to
+		// totalWeight. Only every stride-th node of the sorted nodes (and the last one) is used: stride 2 interpolates
+		// the same evaluations over twice the node spacing. Where the refinement is uniform this drops the midpoints
+		// of the last bisection, where neighbouring intervals are refined to different depths it drops nodes of
+		// several passes, so it is a map of half the nodes rather than the map of an earlier pass.
+		HistogramAccumulator pushForward(const int& numBins, const double& minRange, const double& maxRange, const double& totalWeight, const int& stride = 1) const
+		{
+			HistogramAccumulator histogram(numBins, minRange, maxRange);
+			std::vector<int> nodeIndices;
+			for(int nodeIndex = 0; nodeIndex < static_cast<int>(nodes.size()); nodeIndex += stride) nodeIndices.push_back(nodeIndex);
+			if(nodeIndices.back() != static_cast<int>(nodes.size()) - 1) nodeIndices.push_back(nodes.size() - 1);
+			const double binWidth = (maxRange - minRange) / numBins;
+			std::vector<double> contents(numBins + 2, 0.0);
+			double totalContent = 0.0;
+			for(unsigned int index = 0; index + 1 < nodeIndices.size(); ++index)
+			{
+				const Node& left  = nodes[nodeIndices[index]];
+				const Node& right = nodes[nodeIndices[index + 1]];
+				const double width = right.startX - left.startX;
+				if(left.absorbed || right.absorbed || maxHitStep < std::abs(right.hitX - left.hitX))
+				{
+					// Half of the interval to each end that is not absorbed
+					if(!left.absorbed)  contents[histogram.findBin(left.hitX)]  += 0.5 * width;
+					if(!right.absorbed) contents[histogram.findBin(right.hitX)] += 0.5 * width;
+					totalContent += 0.5 * width * (!left.absorbed + !right.absorbed);
+					continue;
+				}
+				totalContent += width;
+				const double low  = std::min(left.hitX, right.hitX);
+				const double high = std::max(left.hitX, right.hitX);
+				const int lowBin  = histogram.findBin(low);
+				const int highBin = histogram.findBin(high);
+				if(lowBin == highBin)
+				{
+					contents[lowBin] += width;
+					continue;
+				}
+				for(int bin = lowBin; bin <= highBin; ++bin)
+				{
+					const double binLow  = bin == 0       ? low  : std::max(low,  minRange + (bin - 1) * binWidth);
+					const double binHigh = bin == numBins + 1 ? high : std::min(high, minRange + bin * binWidth);
+					contents[bin] += width * std::max(0.0, binHigh - binLow) / (high - low);
+				}
+			}
+			for(int bin = 0; bin < numBins + 2 && 0.0 < totalContent; ++bin) histogram.setBinContent(bin, totalWeight * contents[bin] / totalContent);
+			histogram.setNumEntries(totalWeight);
+			return histogram;
+		}
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef BARNES_HUT_TREE_H
+#define BARNES_HUT_TREE_H
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+using glm::vec3;
+
+// Octree of point charges of the same sign for the field of many charges on each other in O(N log N)
+// (Barnes-Hut). A cell seen under an angle below the opening angle acts as a single charge at its center
+// of charge, closer cells are opened; the charges of a leaf are summed directly. The field is the sum
+// of ChargedParticle::getPotentialAt(), charges are multiplied by the Coulomb constant already.
+class BarnesHutTree
+{
+	private:
+		static constexpr int LEAF_SIZE = 8;
+		static constexpr int MAX_DEPTH = 32; // cells this deep are leaves, however many (coinciding) charges they hold
+		struct Node
+		{
+			vec3  center;         // of the cube
+			float halfSize;
+			vec3  centerOfCharge;
+			float charge;
+			int   firstChild = -1; // children are stored consecutively, -1 for a leaf
+			int   numChildren = 0;
+			int   begin;           // charges [begin, end) of the sorted arrays
+			int   end;
+		};
+		float              openingAngleSquared;
+		std::vector<Node>  nodes;
+		std::vector<vec3>  sortedPositions;
+		std::vector<float> sortedCharges;
+		std::vector<vec3>  positionBuffer;
+		std::vector<float> chargeBuffer;
+		std::vector<int>   sortedIndices;
+		std::vector<int>   indexBuffer;
+		std::vector<vec3>  farCenters;     // interaction list of a leaf: cells acting as single charges
+		std::vector<float> farCharges;
+		std::vector<int>   nearBegins;     // and ranges of charges summed directly
+		std::vector<int>   traversalStack;
+		static int octant(const vec3& position, const vec3& center)
+		{
+			return (center.x <= position.x) | ((center.y <= position.y) << 1) | ((center.z <= position.z) << 2);
+		}
+		void buildNode(const int& nodeIndex, const int& depth)
+		{
+			const int begin = nodes[nodeIndex].begin;
+			const int end   = nodes[nodeIndex].end;
+			vec3  centerOfCharge(0, 0, 0);
+			float charge = 0.0f;
+			for(int index = begin; index < end; ++index)
+			{
+				centerOfCharge += sortedCharges[index] * sortedPositions[index];
+				charge         += sortedCharges[index];
+			}
+			nodes[nodeIndex].centerOfCharge = charge != 0.0f ? centerOfCharge / charge : nodes[nodeIndex].center;
+			nodes[nodeIndex].charge         = charge;
+			if(end - begin <= LEAF_SIZE || MAX_DEPTH <= depth) return;
+			// Counting sort of the charges by octant
+			const vec3 center = nodes[nodeIndex].center;
+			std::array<int, 9> octantBegin;
+			octantBegin.fill(0);
+			for(int index = begin; index < end; ++index) ++octantBegin[octant(sortedPositions[index], center) + 1];
+			for(int childOctant = 0; childOctant < 8; ++childOctant) octantBegin[childOctant + 1] += octantBegin[childOctant];
+			std::array<int, 8> octantFill;
+			std::copy(octantBegin.begin(), octantBegin.begin() + 8, octantFill.begin());
+			for(int index = begin; index < end; ++index)
+			{
+				const int target = begin + octantFill[octant(sortedPositions[index], center)]++;
+				positionBuffer[target] = sortedPositions[index];
+				chargeBuffer[target]   = sortedCharges[index];
+				indexBuffer[target]    = sortedIndices[index];
+			}
+			std::copy(positionBuffer.begin() + begin, positionBuffer.begin() + end, sortedPositions.begin() + begin);
+			std::copy(chargeBuffer.begin()   + begin, chargeBuffer.begin()   + end, sortedCharges.begin()   + begin);
+			std::copy(indexBuffer.begin()    + begin, indexBuffer.begin()    + end, sortedIndices.begin()   + begin);
+			const float childHalfSize = 0.5f * nodes[nodeIndex].halfSize;
+			const int   firstChild    = nodes.size();
+			for(int childOctant = 0; childOctant < 8; ++childOctant)
+			{
+				if(octantBegin[childOctant] == octantBegin[childOctant + 1]) continue;
+				Node child;
+				child.center   = center + childHalfSize * vec3((childOctant & 1) ? 1.0f : -1.0f, (childOctant & 2) ? 1.0f : -1.0f, (childOctant & 4) ? 1.0f : -1.0f);
+				child.halfSize = childHalfSize;
+				child.begin    = begin + octantBegin[childOctant];
+				child.end      = begin + octantBegin[childOctant + 1];
+				nodes.push_back(child);
+			}
+			nodes[nodeIndex].firstChild  = firstChild;
+			nodes[nodeIndex].numChildren = nodes.size() - firstChild;
+			for(int childIndex = firstChild; childIndex < firstChild + nodes[nodeIndex].numChildren; ++childIndex) buildNode(childIndex, depth + 1);
+		}
+	public:
+		// An opening angle of 0 opens every cell: the direct sum
+		BarnesHutTree(const float& openingAngle = 0.5f): openingAngleSquared(openingAngle * openingAngle) {}
+		// The arrays are copied, the tree stays valid when they change
+		void build(const vec3* positions, const float* charges, const int& numCharges)
+		{
+			nodes.clear();
+			sortedPositions.assign(positions, positions + numCharges);
+			sortedCharges  .assign(charges,   charges   + numCharges);
+			positionBuffer.resize(numCharges);
+			chargeBuffer  .resize(numCharges);
+			indexBuffer   .resize(numCharges);
+			sortedIndices .resize(numCharges);
+			for(int index = 0; index < numCharges; ++index) sortedIndices[index] = index;
+			if(numCharges == 0) return;
+			vec3 minPosition = positions[0];
+			vec3 maxPosition = positions[0];
+			for(int index = 1; index < numCharges; ++index)
+			{
+				minPosition = glm::min(minPosition, positions[index]);
+				maxPosition = glm::max(maxPosition, positions[index]);
+			}
+			const vec3 extent = maxPosition - minPosition;
+			Node root;
+			root.center   = 0.5f * (minPosition + maxPosition);
+			root.halfSize = 0.5f * std::max(extent.x, std::max(extent.y, extent.z)) * 1.0001f + 1e-6f;
+			root.begin    = 0;
+			root.end      = numCharges;
+			nodes.push_back(root);
+			buildNode(0, 0);
+		}
+		// Field of the other charges at every charge, in the order given to build(). The cells are opened for a leaf at
+		// a time rather than for every charge: a cell is far from a leaf when it is seen under less than the opening
+		// angle from any point of the leaf, and the interaction list of the leaf is shared by its charges.
+		void calculatePotentials(std::vector<vec3>& potentials)
+		{
+			potentials.assign(sortedPositions.size(), vec3(0, 0, 0));
+			for(const Node& leaf: nodes)
+			{
+				if(0 <= leaf.firstChild) continue;
+				const float leafRadius = std::sqrt(3.0f) * leaf.halfSize;
+				farCenters.clear();
+				farCharges.clear();
+				nearBegins.clear();
+				traversalStack.assign(1, 0);
+				while(!traversalStack.empty())
+				{
+					const Node& node = nodes[traversalStack.back()];
+					traversalStack.pop_back();
+					if(node.firstChild < 0)
+					{
+						nearBegins.push_back(node.begin);
+						nearBegins.push_back(node.end);
+						continue;
+					}
+					// A cell containing the leaf is always opened: for opening angles above 1 / sqrt(3) its center of charge
+					// can be far enough from the leaf
+					const bool containsLeaf = node.begin <= leaf.begin && leaf.end <= node.end;
+					const float distance = glm::length(node.centerOfCharge - leaf.center) - leafRadius;
+					if(!containsLeaf && 0.0f < distance && 4.0f * node.halfSize * node.halfSize < openingAngleSquared * distance * distance)
+					{
+						farCenters.push_back(node.centerOfCharge);
+						farCharges.push_back(node.charge);
+						continue;
+					}
+					for(int childIndex = node.firstChild; childIndex < node.firstChild + node.numChildren; ++childIndex) traversalStack.push_back(childIndex);
+				}
+				for(int index = leaf.begin; index < leaf.end; ++index)
+				{
+					const vec3 position = sortedPositions[index];
+					vec3 potential(0, 0, 0);
+					for(unsigned int far = 0; far < farCenters.size(); ++far)
+					{
+						const vec3 toCenter = farCenters[far] - position;
+						potential += farCharges[far] / glm::dot(toCenter, toCenter) * toCenter;
+					}
+					for(unsigned int near = 0; near < nearBegins.size(); near += 2)
+					{
+						for(int source = nearBegins[near]; source < nearBegins[near + 1]; ++source)
+						{
+							const vec3  toCharge        = sortedPositions[source] - position;
+							const float distanceSquared = glm::dot(toCharge, toCharge);
+							// The charge itself and charges at the same position
+							if(0.0f < distanceSquared) potential += sortedCharges[source] / distanceSquared * toCharge;
+						}
+					}
+					potentials[sortedIndices[index]] = potential;
+				}
+			}
+		}
+};
+
+constexpr int BarnesHutTree::LEAF_SIZE;
+constexpr int BarnesHutTree::MAX_DEPTH;
+
+#endif
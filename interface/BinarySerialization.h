@@ -0,0 +1,75 @@
+#ifndef BINARY_SERIALIZATION_H
+#define BINARY_SERIALIZATION_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <type_traits>
+
+// Exact binary images of numbers, vectors of numbers and vectors of objects with write()/read() members
+// (histogram accumulators, absorption maps...), in the byte order of the machine. Used by the result
+// cache and the checkpoints, that are read back by the same build on the same machine. The sizes read from
+// a file are checked against the bytes left in it before anything is allocated for them, so that truncated
+// or corrupt files are rejected rather than exhausting the memory.
+// Bytes from the read position to the end of a seekable stream, 0 if it is not seekable or failed
+inline std::uint64_t numBytesLeft(std::istream& stream)
+{
+	const std::istream::pos_type position = stream.tellg();
+	if(position == std::istream::pos_type(-1)) return 0;
+	stream.seekg(0, std::ios::end);
+	const std::istream::pos_type end = stream.tellg();
+	stream.seekg(position);
+	return end == std::istream::pos_type(-1) || end < position ? 0 : static_cast<std::uint64_t>(end - position);
+}
+template <class T>
+void writeValue(std::ostream& stream, const T& value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as they are.");
+	stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+template <class T>
+bool readValue(std::istream& stream, T& value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as they are.");
+	stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+	return static_cast<bool>(stream);
+}
+template <class T>
+void writeValues(std::ostream& stream, const std::vector<T>& values)
+{
+	writeValue(stream, static_cast<std::uint64_t>(values.size()));
+	stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+template <class T>
+bool readValues(std::istream& stream, std::vector<T>& values)
+{
+	std::uint64_t size = 0;
+	if(!readValue(stream, size) || numBytesLeft(stream) / sizeof(T) < size) return false;
+	values.resize(size);
+	stream.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+	return static_cast<bool>(stream);
+}
+template <class Object>
+void writeObjects(std::ostream& stream, const std::vector<Object>& objects)
+{
+	writeValue(stream, static_cast<std::uint64_t>(objects.size()));
+	for(const auto& object: objects) object.write(stream);
+}
+// The objects are copies of the prototype overwritten by read(), added as they are read: every image takes
+// at least a byte, and the objects allocated are limited by the images actually found
+template <class Object>
+bool readObjects(std::istream& stream, std::vector<Object>& objects, const Object& prototype)
+{
+	std::uint64_t size = 0;
+	if(!readValue(stream, size) || numBytesLeft(stream) < size) return false;
+	objects.clear();
+	for(std::uint64_t index = 0; index < size; ++index)
+	{
+		objects.push_back(prototype);
+		if(!objects.back().read(stream)) return false;
+	}
+	return true;
+}
+
+#endif
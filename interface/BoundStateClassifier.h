@@ -0,0 +1,63 @@
+#ifndef BOUND_STATE_CLASSIFIER_H
+#define BOUND_STATE_CLASSIFIER_H
+
+#include "ChargedParticle.h"
+
+// Decides after every update whether a charged particle got captured by the target.
+// A particle is considered bound when its total energy is negative, it is inside
+// the bounding region of the target, and it has already passed a given number of
+// periapses (local maxima of the potential magnitude felt by the particle) while bound.
+// Only the data cached by ChargedParticle::update() is used, so the test is cheap
+// enough to be run every step.
+class BoundStateClassifier
+{
+	private:
+		vec3  regionMin;
+		vec3  regionMax;
+		int   minPeriapses;
+		int   numPeriapses          = 0;
+		int   numPotentialSamples   = 0;
+		float lastPotentialLength   = 0.0f;
+		float beforeLastPotentialLength = 0.0f;
+	public:
+		BoundStateClassifier(const vec3& regionMinArg, const vec3& regionMaxArg, const int& minPeriapsesArg):
+			regionMin(regionMinArg), regionMax(regionMaxArg), minPeriapses(minPeriapsesArg) {}
+		void reset()
+		{
+			numPeriapses        = 0;
+			numPotentialSamples = 0;
+		}
+		int getNumPeriapses() const { return numPeriapses; }
+		bool isInsideRegion(const vec3& positionArg) const
+		{
+			return
+				regionMin.x <= positionArg.x && positionArg.x <= regionMax.x &&
+				regionMin.y <= positionArg.y && positionArg.y <= regionMax.y &&
+				regionMin.z <= positionArg.z && positionArg.z <= regionMax.z;
+		}
+		// Returns 1 if the particle is classified as bound
+		int update(const ChargedParticle& particle)
+		{
+			return update(particle.getStageTotalEnergy(), particle.getPosition(), particle.getStagePotential());
+		}
+		// Same test from the cached step data of a particle that is not a ChargedParticle (e.g. a lane of an ElectronBundle)
+		int update(const float& stageTotalEnergy, const vec3& position, const vec3& stagePotential)
+		{
+			if(0.0f <= stageTotalEnergy || !isInsideRegion(position))
+			{
+				reset();
+				return 0;
+			}
+			float potentialLength = glm::length(stagePotential);
+			if(2 <= numPotentialSamples && beforeLastPotentialLength < lastPotentialLength && potentialLength <= lastPotentialLength)
+			{
+				++numPeriapses;
+			}
+			beforeLastPotentialLength = lastPotentialLength;
+			lastPotentialLength       = potentialLength;
+			++numPotentialSamples;
+			return minPeriapses <= numPeriapses;
+		}
+};
+
+#endif
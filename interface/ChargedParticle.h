@@ -12,6 +12,14 @@ class ChargedParticle: public Particle
 		static constexpr float vacuumPermittivity = 0.079577f;
 		// static constexpr float coulombConstant = 1.0f / (4.0f * 3.1415926f * vacuumPermittivity);
 		static constexpr float coulombConstant = 1.0f;
+		// Cached from the first Runge-Kutta stage of the last update(), so that
+		// energy bookkeeping does not need another sum over the field sources
+		vec3  stagePotential   = vec3(0, 0, 0);
+		float stageTotalEnergy = 0.0f;
+		// Fixed charges acting on this particle besides the other charged particles, e.g. a large target shared by the threads
+		const vec3*  externalChargePositions = nullptr;
+		const float* externalCharges         = nullptr;
+		int          numExternalCharges      = 0;
 	public:
 		ChargedParticle():
 		Particle(), charge(0) 
@@ -64,8 +72,20 @@ class ChargedParticle: public Particle
 				if(particle == this) continue;
 				potential += particle -> getPotentialAt(position);
 			}
+			for(int index = 0; index < numExternalCharges; ++index)
+			{
+				float distance = glm::length(externalChargePositions[index] - position);
+				potential += coulombConstant * externalCharges[index] / (distance * distance) * (externalChargePositions[index] - position);
+			}
 			return calculateForceFromPotential(potential);
 		}
+		// The arrays are not copied, they have to outlive the particle or the next call
+		void setExternalCharges(const vec3* positions, const float* charges, const int& numCharges)
+		{
+			externalChargePositions = positions;
+			externalCharges         = charges;
+			numExternalCharges      = numCharges;
+		}
 		virtual vec3 getPotentialAt(const vec3& positionArg) const
 		{
 			float distance = glm::length(position - positionArg);
@@ -88,7 +108,9 @@ class ChargedParticle: public Particle
 		{
 			static const float oneOverSix = 1.0f / 6.0f;
 			// std::cout << "Before: (" << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
-			vec3 k1 = dt * getAccelerationAtPosition(position);
+			stagePotential   = getPotentialFromOtherParticlesAtPosition(position);
+			stageTotalEnergy = calculatePotentialEnergy(stagePotential) + calculateKineticEnergy();
+			vec3 k1 = dt * (-charge / mass) * stagePotential;
 			vec3 l1 = dt * velocity;
 			vec3 k2 = dt * getAccelerationAtPosition(position + 0.5f * l1);
 			vec3 l2 = dt * (velocity + 0.5f * k1);
@@ -101,7 +123,11 @@ class ChargedParticle: public Particle
 			// std::cout << "After: (" << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
 			// std::cin.get();
 		}
-		static std::vector<ChargedParticle*> chargedParticleCollection;
+		// Potential and total energy at the start of the last update() step
+		vec3  getStagePotential()   const { return stagePotential;   }
+		float getStageTotalEnergy() const { return stageTotalEnergy; }
+		// Per-thread, like Particle::particleCollection
+		static thread_local std::vector<ChargedParticle*> chargedParticleCollection;
 		vec3 getPotentialFromOtherParticlesAtPosition(vec3 positionArg) const
 		{
 			vec3 potential(0, 0, 0);
@@ -111,6 +137,11 @@ class ChargedParticle: public Particle
 				float distance = glm::length(positionArg - chargedParticle -> getPosition());
 				potential += (coulombConstant * chargedParticle -> getCharge()) / (distance * distance) * (chargedParticle -> getPosition() - positionArg);
 			}
+			for(int index = 0; index < numExternalCharges; ++index)
+			{
+				float distance = glm::length(positionArg - externalChargePositions[index]);
+				potential += (coulombConstant * externalCharges[index]) / (distance * distance) * (externalChargePositions[index] - positionArg);
+			}
 			return potential;
 		}
 		vec3 getPotentialFromOtherParticles() const
@@ -123,6 +154,6 @@ class ChargedParticle: public Particle
 		}
 };
 
-std::vector<ChargedParticle*> ChargedParticle::chargedParticleCollection;
+thread_local std::vector<ChargedParticle*> ChargedParticle::chargedParticleCollection;
 
 #endif
\ No newline at end of file
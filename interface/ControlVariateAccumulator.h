@@ -0,0 +1,82 @@
+#ifndef CONTROL_VARIATE_ACCUMULATOR_H
+#define CONTROL_VARIATE_ACCUMULATOR_H
+
+#include <vector>
+
+#include "HistogramAccumulator.h"
+
+// Control histogram C filled by the same experiments as a target histogram Y (e.g. the hit position
+// predicted by a cheap analytic model next to the integrated one), with the per-bin sums of Y * C. Every
+// experiment fills the control, also those without a target entry, so that its expectation is known.
+class ControlVariateAccumulator
+{
+	private:
+		HistogramAccumulator control;
+		std::vector<double>  crossProducts;
+	public:
+		ControlVariateAccumulator(const int& numBins, const double& minRange, const double& maxRange):
+			control(numBins, minRange, maxRange), crossProducts(numBins + 2, 0.0) {}
+		const HistogramAccumulator& getControl() const { return control; }
+		double getCrossProduct(const int& bin) const { return crossProducts[bin]; }
+		void fill(const double& targetX, const double& targetWeight, const double& controlX, const double& controlWeight)
+		{
+			control.fill(controlX, controlWeight);
+			const int bin = control.findBin(controlX);
+			if(bin == control.findBin(targetX)) crossProducts[bin] += targetWeight * controlWeight;
+		}
+		// An experiment without a target entry
+		void fillControl(const double& controlX, const double& controlWeight) { control.fill(controlX, controlWeight); }
+		void write(std::ostream& stream) const
+		{
+			control.write(stream);
+			stream.write(reinterpret_cast<const char*>(crossProducts.data()), crossProducts.size() * sizeof(double));
+		}
+		bool read(std::istream& stream)
+		{
+			if(!control.read(stream)) return false;
+			crossProducts.resize(control.getNumBins() + 2);
+			stream.read(reinterpret_cast<char*>(crossProducts.data()), crossProducts.size() * sizeof(double));
+			return static_cast<bool>(stream);
+		}
+		void add(const ControlVariateAccumulator& other)
+		{
+			control.add(other.control);
+			for(int bin = 0; bin < static_cast<int>(crossProducts.size()); ++bin) crossProducts[bin] += other.crossProducts[bin];
+		}
+};
+
+// Control variate corrected replicates Y_r - beta_b (C_r - n_r E[C_b]), where n_r is the number of experiments
+// of a replicate and E[C_b] the exact expected control content of bin b of a single experiment.
+// The coefficient beta_b = Cov(Y_b, C_b) / Var(C_b) is estimated from all replicates pooled.
+// The bin errors of the result are meant to be taken from the spread of the corrected replicates.
+std::vector<HistogramAccumulator> applyControlVariate(const std::vector<HistogramAccumulator>& targetReplicates, const std::vector<ControlVariateAccumulator>& controlReplicates,
+	const std::vector<double>& expectedControlPerExperiment, const int& numExperimentsPerReplicate)
+{
+	std::vector<HistogramAccumulator> corrected(targetReplicates);
+	const double numExperiments = static_cast<double>(numExperimentsPerReplicate) * targetReplicates.size();
+	if(numExperiments < 2) return corrected;
+	for(int bin = 0; bin < targetReplicates.front().getNumBins() + 2; ++bin)
+	{
+		double sumTarget = 0.0, sumControl = 0.0, sumControlSquares = 0.0, sumCrossProducts = 0.0;
+		for(unsigned int replicate = 0; replicate < targetReplicates.size(); ++replicate)
+		{
+			const HistogramAccumulator& control = controlReplicates[replicate].getControl();
+			sumTarget         += targetReplicates[replicate].getBinContent(bin);
+			sumControl        += control.getBinContent(bin);
+			sumControlSquares += control.getBinError(bin) * control.getBinError(bin);
+			sumCrossProducts  += controlReplicates[replicate].getCrossProduct(bin);
+		}
+		const double covariance      = sumCrossProducts  - sumTarget  * sumControl / numExperiments;
+		const double controlVariance = sumControlSquares - sumControl * sumControl / numExperiments;
+		if(controlVariance <= 0.0) continue;
+		const double coefficient = covariance / controlVariance;
+		for(unsigned int replicate = 0; replicate < targetReplicates.size(); ++replicate)
+		{
+			const double controlDeviation = controlReplicates[replicate].getControl().getBinContent(bin) - numExperimentsPerReplicate * expectedControlPerExperiment[bin];
+			corrected[replicate].setBinContent(bin, targetReplicates[replicate].getBinContent(bin) - coefficient * controlDeviation);
+		}
+	}
+	return corrected;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef DETECTOR_STAGE_H
+#define DETECTOR_STAGE_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "HistogramAccumulator.h"
+
+using glm::vec3;
+
+// Surface crossed by the trajectories: a plane given by a point and a unit normal, or a sphere
+struct DetectorSurface
+{
+	enum Shape { PLANE, SPHERE };
+	Shape       shape;
+	vec3        point;  // plane: a point of the plane, sphere: center
+	vec3        normal; // plane only
+	float       radius; // sphere only
+	std::string name;
+	// The crossings of a trajectory are the sign changes of the signed distance
+	float signedDistance(const vec3& position) const
+	{
+		if(shape == PLANE) return glm::dot(position - point, normal);
+		return glm::length(position - point) - radius;
+	}
+	// Whether the surface is its own mirror image at the plane axis = 0 (axis 0: x, 1: y, 2: z)
+	bool isMirrorSymmetric(const int& axis, const float& tolerance) const
+	{
+		if(shape == SPHERE) return std::abs(point[axis]) < tolerance;
+		const bool normalInPlane    = std::abs(normal[axis]) < tolerance;
+		const bool normalAlongAxis  = std::abs(std::abs(normal[axis]) - 1.0f) < tolerance && std::abs(point[axis]) < tolerance;
+		return normalInPlane || normalAlongAxis;
+	}
+};
+
+struct DetectorCrossing
+{
+	int   surfaceIndex;
+	vec3  position;
+	vec3  direction;     // unit vector of the velocity
+	float kineticEnergy;
+	float timeOfFlight;  // from the start of the experiment
+};
+
+// Histogram of a quantity of the crossings of a surface
+struct DetectorObservable
+{
+	enum Quantity { POSITION_X, POSITION_Y, POSITION_Z, DIRECTION_X, DIRECTION_Y, DIRECTION_Z, SCATTERING_ANGLE, KINETIC_ENERGY, TIME_OF_FLIGHT };
+	std::string name;
+	int         surfaceIndex;
+	Quantity    quantity;
+	int         numBins;
+	double      minRange;
+	double      maxRange;
+};
+
+// Records the crossings of any number of planes and spheres along a trajectory, so that every observable
+// is filled by a single run. The crossing point, velocity and time are interpolated linearly inside the step.
+class DetectorStage
+{
+	private:
+		std::vector<DetectorSurface>    surfaces;
+		std::vector<DetectorObservable> observables;
+		vec3                            beamDirection; // unit vector, the scattering angle is measured from it
+		double quantity(const DetectorObservable& observable, const DetectorCrossing& crossing) const
+		{
+			switch(observable.quantity)
+			{
+				case DetectorObservable::POSITION_X:       return crossing.position.x;
+				case DetectorObservable::POSITION_Y:       return crossing.position.y;
+				case DetectorObservable::POSITION_Z:       return crossing.position.z;
+				case DetectorObservable::DIRECTION_X:      return crossing.direction.x;
+				case DetectorObservable::DIRECTION_Y:      return crossing.direction.y;
+				case DetectorObservable::DIRECTION_Z:      return crossing.direction.z;
+				case DetectorObservable::SCATTERING_ANGLE: return std::acos(std::min(1.0f, std::max(-1.0f, glm::dot(crossing.direction, beamDirection))));
+				case DetectorObservable::KINETIC_ENERGY:   return crossing.kineticEnergy;
+				case DetectorObservable::TIME_OF_FLIGHT:   return crossing.timeOfFlight;
+			}
+			return 0.0;
+		}
+	public:
+		DetectorStage(const std::vector<DetectorSurface>& surfacesArg, const std::vector<DetectorObservable>& observablesArg, const vec3& beamDirectionArg):
+			surfaces(surfacesArg), observables(observablesArg), beamDirection(glm::normalize(beamDirectionArg)) {}
+		const std::vector<DetectorSurface>&    getSurfaces()    const { return surfaces;    }
+		const std::vector<DetectorObservable>& getObservables() const { return observables; }
+		// Whether every surface is its own mirror image at the plane axis = 0
+		bool isMirrorSymmetric(const int& axis, const float& tolerance) const
+		{
+			return std::all_of(surfaces.begin(), surfaces.end(), [&] (const DetectorSurface& surface) { return surface.isMirrorSymmetric(axis, tolerance); });
+		}
+		// Appends the crossings of the step from (previousPosition, previousVelocity) at previousTime to (position, velocity)
+		void recordCrossings(const vec3& previousPosition, const vec3& previousVelocity, const vec3& position, const vec3& velocity,
+			const float& previousTime, const float& dt, const float& mass, std::vector<DetectorCrossing>& crossings) const
+		{
+			for(unsigned int surfaceIndex = 0; surfaceIndex < surfaces.size(); ++surfaceIndex)
+			{
+				const float previousDistance = surfaces[surfaceIndex].signedDistance(previousPosition);
+				const float distance         = surfaces[surfaceIndex].signedDistance(position);
+				if((previousDistance < 0.0f) == (distance < 0.0f)) continue;
+				const float fraction = previousDistance / (previousDistance - distance);
+				const vec3  crossingVelocity = previousVelocity + fraction * (velocity - previousVelocity);
+				crossings.push_back(DetectorCrossing{static_cast<int>(surfaceIndex), previousPosition + fraction * (position - previousPosition),
+					glm::normalize(crossingVelocity), 0.5f * mass * glm::dot(crossingVelocity, crossingVelocity), previousTime + fraction * dt});
+			}
+		}
+		std::vector<HistogramAccumulator> createHistograms() const
+		{
+			std::vector<HistogramAccumulator> histograms;
+			for(const auto& observable: observables) histograms.emplace_back(observable.numBins, observable.minRange, observable.maxRange);
+			return histograms;
+		}
+		// Fills the crossings of a trajectory into the histograms of the observables. With mirrorX / mirrorZ the
+		// mirror images of the crossings are filled as well, sharing the weight (unfolding of a sampled half domain).
+		// Images and repeated crossings of a trajectory landing in the same bin are a single fill of their summed
+		// weight, so the sums of squared weights stay the variances of sums of independent trajectories.
+		void fill(const std::vector<DetectorCrossing>& crossings, const double& weight, const bool& mirrorX, const bool& mirrorZ, std::vector<HistogramAccumulator>& histograms) const
+		{
+			const double imageWeight = weight / ((1 + mirrorX) * (1 + mirrorZ));
+			// Per observable: a quantity of each bin that is hit and the weight of the bin
+			std::vector<std::vector<std::pair<double, double>>> binFills(observables.size());
+			for(const auto& crossing: crossings)
+			{
+				for(int xSign = 1; -1 <= xSign; xSign -= 2)
+				{
+					for(int zSign = 1; -1 <= zSign; zSign -= 2)
+					{
+						if((xSign < 0 && !mirrorX) || (zSign < 0 && !mirrorZ)) continue;
+						const vec3 imagePosition (xSign * crossing.position.x,  crossing.position.y,  zSign * crossing.position.z);
+						const vec3 imageDirection(xSign * crossing.direction.x, crossing.direction.y, zSign * crossing.direction.z);
+						const DetectorCrossing image{crossing.surfaceIndex, imagePosition, imageDirection, crossing.kineticEnergy, crossing.timeOfFlight};
+						for(unsigned int observableIndex = 0; observableIndex < observables.size(); ++observableIndex)
+						{
+							if(observables[observableIndex].surfaceIndex != image.surfaceIndex) continue;
+							const double value = quantity(observables[observableIndex], image);
+							const int    bin   = histograms[observableIndex].findBin(value);
+							auto& fills = binFills[observableIndex];
+							auto sameBin = std::find_if(fills.begin(), fills.end(), [&histograms, observableIndex, bin] (const std::pair<double, double>& binFill)
+							{
+								return histograms[observableIndex].findBin(binFill.first) == bin;
+							});
+							if(sameBin == fills.end()) fills.emplace_back(value, imageWeight);
+							else                       sameBin -> second += imageWeight;
+						}
+					}
+				}
+			}
+			for(unsigned int observableIndex = 0; observableIndex < observables.size(); ++observableIndex)
+			{
+				for(const auto& binFill: binFills[observableIndex]) histograms[observableIndex].fill(binFill.first, binFill.second);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef ELECTRON_BUNCH_H
+#define ELECTRON_BUNCH_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "BarnesHutTree.h"
+
+using glm::vec3;
+
+// Electrons of a beam bunch traversing the target together, repelling each other (space charge). The field of the
+// fixed target charges is summed directly for every electron as in ChargedParticle, the field of the other electrons
+// is taken from a BarnesHutTree rebuilt at every Runge-Kutta stage. update() is the Runge-Kutta 4 step of
+// ChargedParticle::update() on the active electrons; deactivated (finished) electrons are frozen and no longer
+// act on the others. The stage potential and energy are those of the target charges alone: the potential energy
+// charge * |E| of ChargedParticle is negative whatever the sign of the source, with the field of a close neighbour
+// an electron would look bound to the target.
+class ElectronBunch
+{
+	private:
+		float              charge;
+		float              mass;
+		float              sourceCharge;     // of an electron acting on the others, multiplied by the Coulomb constant
+		const vec3*        targetPositions;
+		const float*       targetCharges;
+		int                numTargetCharges;
+		bool               spaceCharge;
+		BarnesHutTree      tree;
+		std::vector<vec3>  position;
+		std::vector<vec3>  velocity;
+		std::vector<vec3>  stagePotential;
+		std::vector<float> stageTotalEnergy;
+		std::vector<int>   activeElectrons;  // indices of the active electrons, the stage arrays are indexed like it
+		std::vector<vec3>  stagePositions;
+		std::vector<float> stageCharges;
+		std::vector<vec3>  electronPotentials;
+		std::vector<vec3>  targetPotentials;
+		// Field at the stage positions of the active electrons, and the part of the target charges in targetPotentialsArg
+		// if given
+		void potentialAtStagePositions(std::vector<vec3>& potentials, std::vector<vec3>* targetPotentialsArg = nullptr)
+		{
+			if(spaceCharge)
+			{
+				tree.build(stagePositions.data(), stageCharges.data(), stagePositions.size());
+				tree.calculatePotentials(potentials);
+			}
+			else potentials.assign(stagePositions.size(), vec3(0, 0, 0));
+			if(targetPotentialsArg) targetPotentialsArg -> resize(stagePositions.size());
+			for(unsigned int active = 0; active < stagePositions.size(); ++active)
+			{
+				const vec3 positionArg = stagePositions[active];
+				vec3 potential(0, 0, 0);
+				for(int index = 0; index < numTargetCharges; ++index)
+				{
+					float distance = glm::length(positionArg - targetPositions[index]);
+					potential += targetCharges[index] / (distance * distance) * (targetPositions[index] - positionArg);
+				}
+				potentials[active] += potential;
+				if(targetPotentialsArg) (*targetPotentialsArg)[active] = potential;
+			}
+		}
+	public:
+		// sourceChargeArg (the charge of an electron as a source of the field) and targetCharges are multiplied by the Coulomb
+		// constant already, the arrays are not copied and have to outlive the bunch. Without spaceCharge the electrons are
+		// independent, as in single electron experiments.
+		ElectronBunch(const float& chargeArg, const float& massArg, const float& sourceChargeArg, const vec3* targetPositionsArg, const float* targetChargesArg,
+			const int& numTargetChargesArg, const int& numElectrons, const float& openingAngle, const bool& spaceChargeArg):
+			charge(chargeArg), mass(massArg), sourceCharge(sourceChargeArg), targetPositions(targetPositionsArg), targetCharges(targetChargesArg), numTargetCharges(numTargetChargesArg),
+			spaceCharge(spaceChargeArg), tree(openingAngle), position(numElectrons, vec3(0, 0, 0)), velocity(numElectrons, vec3(0, 0, 0)),
+			stagePotential(numElectrons, vec3(0, 0, 0)), stageTotalEnergy(numElectrons, 0.0f) {}
+		int   getNumElectrons() const { return position.size(); }
+		int   getNumActive()    const { return activeElectrons.size(); }
+		// Sets the start conditions of an electron and activates it
+		void setElectron(const int& electron, const vec3& positionArg, const vec3& velocityArg)
+		{
+			position[electron] = positionArg;
+			velocity[electron] = velocityArg;
+			activeElectrons.push_back(electron);
+		}
+		void deactivate(const int& electron)
+		{
+			activeElectrons.erase(std::remove(activeElectrons.begin(), activeElectrons.end(), electron), activeElectrons.end());
+		}
+		// Indices of the active electrons, changed by deactivate()
+		const std::vector<int>& getActiveElectrons() const { return activeElectrons; }
+		vec3  getPosition        (const int& electron) const { return position[electron]; }
+		vec3  getVelocity        (const int& electron) const { return velocity[electron]; }
+		// Potential of the target charges and total energy in it at the start of the last update() step, as in ChargedParticle
+		vec3  getStagePotential  (const int& electron) const { return stagePotential[electron]; }
+		float getStageTotalEnergy(const int& electron) const { return stageTotalEnergy[electron]; }
+		void update(const float& dt)
+		{
+			static const float oneOverSix = 1.0f / 6.0f;
+			const unsigned int numActive = activeElectrons.size();
+			const float accelerationFactor = -charge / mass;
+			std::vector<vec3> k1(numActive), k2(numActive), k3(numActive), k4(numActive), l1(numActive), l2(numActive), l3(numActive), l4(numActive);
+			stageCharges.assign(numActive, sourceCharge);
+			stagePositions.resize(numActive);
+			for(unsigned int active = 0; active < numActive; ++active) stagePositions[active] = position[activeElectrons[active]];
+			potentialAtStagePositions(electronPotentials, &targetPotentials);
+			for(unsigned int active = 0; active < numActive; ++active)
+			{
+				const int electron = activeElectrons[active];
+				stagePotential[electron]   = targetPotentials[active];
+				stageTotalEnergy[electron] = charge * glm::length(targetPotentials[active]) + 0.5f * mass * glm::dot(velocity[electron], velocity[electron]);
+				k1[active] = dt * accelerationFactor * electronPotentials[active];
+				l1[active] = dt * velocity[electron];
+				stagePositions[active] = position[electron] + 0.5f * l1[active];
+			}
+			potentialAtStagePositions(electronPotentials);
+			for(unsigned int active = 0; active < numActive; ++active)
+			{
+				const int electron = activeElectrons[active];
+				k2[active] = dt * (accelerationFactor * electronPotentials[active]);
+				l2[active] = dt * (velocity[electron] + 0.5f * k1[active]);
+				stagePositions[active] = position[electron] + 0.5f * l2[active];
+			}
+			potentialAtStagePositions(electronPotentials);
+			for(unsigned int active = 0; active < numActive; ++active)
+			{
+				const int electron = activeElectrons[active];
+				k3[active] = dt * (accelerationFactor * electronPotentials[active]);
+				l3[active] = dt * (velocity[electron] + 0.5f * k2[active]);
+				stagePositions[active] = position[electron] + l3[active];
+			}
+			potentialAtStagePositions(electronPotentials);
+			for(unsigned int active = 0; active < numActive; ++active)
+			{
+				const int electron = activeElectrons[active];
+				k4[active] = dt * (accelerationFactor * electronPotentials[active]);
+				l4[active] = dt * (velocity[electron] + k3[active]);
+				velocity[electron] = velocity[electron] + oneOverSix * (k1[active] + 2.0f * k2[active] + 2.0f * k3[active] + k4[active]);
+				position[electron] = position[electron] + oneOverSix * (l1[active] + 2.0f * l2[active] + 2.0f * l3[active] + l4[active]);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef ELECTRON_BUNDLE_H
+#define ELECTRON_BUNDLE_H
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+
+using glm::vec3;
+
+// NUM_LANES independent point charges moving in the field of fixed sources, stored as structure of arrays
+// (e.g. the same start conditions at the energies of a sweep). The sources are loaded once per force
+// evaluation for every lane, and the per-lane loops have a fixed trip count and no branches, so the
+// compiler can vectorise them. update() is the Runge-Kutta 4 step of ChargedParticle::update() on every
+// active lane, inactive (finished) lanes are kept frozen by a 0/1 mask.
+template <int NUM_LANES>
+class ElectronBundle
+{
+	public:
+		using Lanes = std::array<float, NUM_LANES>;
+	private:
+		struct LaneVectors
+		{
+			alignas(32) Lanes x;
+			alignas(32) Lanes y;
+			alignas(32) Lanes z;
+		};
+		float              charge;
+		float              mass;
+		std::vector<vec3>  sourcePositions;
+		std::vector<float> sourceCharges;
+		LaneVectors        position;
+		LaneVectors        velocity;
+		LaneVectors        stagePotential;
+		alignas(32) Lanes  stageTotalEnergy;
+		alignas(32) Lanes  activeMask;
+		// Same sum as ChargedParticle::getPotentialFromOtherParticlesAtPosition()
+		void potentialAt(const LaneVectors& at, LaneVectors& potential) const
+		{
+			potential.x.fill(0.0f);
+			potential.y.fill(0.0f);
+			potential.z.fill(0.0f);
+			for(unsigned int source = 0; source < sourcePositions.size(); ++source)
+			{
+				const vec3  sourcePosition = sourcePositions[source];
+				const float sourceCharge   = sourceCharges[source];
+				for(int lane = 0; lane < NUM_LANES; ++lane)
+				{
+					const float dx = sourcePosition.x - at.x[lane];
+					const float dy = sourcePosition.y - at.y[lane];
+					const float dz = sourcePosition.z - at.z[lane];
+					const float factor = sourceCharge / (dx * dx + dy * dy + dz * dz);
+					potential.x[lane] += factor * dx;
+					potential.y[lane] += factor * dy;
+					potential.z[lane] += factor * dz;
+				}
+			}
+		}
+		// result = base + scale * derivative, scale being a multiple of the time step
+		static void step(const LaneVectors& base, const LaneVectors& derivative, const float& scale, LaneVectors& result)
+		{
+			for(int lane = 0; lane < NUM_LANES; ++lane)
+			{
+				result.x[lane] = base.x[lane] + scale * derivative.x[lane];
+				result.y[lane] = base.y[lane] + scale * derivative.y[lane];
+				result.z[lane] = base.z[lane] + scale * derivative.z[lane];
+			}
+		}
+	public:
+		// sourceCharges are multiplied by the Coulomb constant already
+		ElectronBundle(const float& chargeArg, const float& massArg, const std::vector<vec3>& sourcePositionsArg, const std::vector<float>& sourceChargesArg):
+			charge(chargeArg), mass(massArg), sourcePositions(sourcePositionsArg), sourceCharges(sourceChargesArg)
+		{
+			for(LaneVectors* vectors: {&position, &velocity, &stagePotential})
+			{
+				vectors -> x.fill(0.0f);
+				vectors -> y.fill(0.0f);
+				vectors -> z.fill(0.0f);
+			}
+			stageTotalEnergy.fill(0.0f);
+			activeMask.fill(0.0f);
+		}
+		void setLane(const int& lane, const vec3& positionArg, const vec3& velocityArg)
+		{
+			position.x[lane] = positionArg.x; position.y[lane] = positionArg.y; position.z[lane] = positionArg.z;
+			velocity.x[lane] = velocityArg.x; velocity.y[lane] = velocityArg.y; velocity.z[lane] = velocityArg.z;
+			activeMask[lane] = 1.0f;
+		}
+		void  deactivate(const int& lane)      { activeMask[lane] = 0.0f; }
+		bool  isActive  (const int& lane) const { return activeMask[lane] != 0.0f; }
+		vec3  getPosition        (const int& lane) const { return vec3(position.x[lane], position.y[lane], position.z[lane]); }
+		vec3  getVelocity        (const int& lane) const { return vec3(velocity.x[lane], velocity.y[lane], velocity.z[lane]); }
+		// Potential and total energy at the start of the last update() step, as in ChargedParticle
+		vec3  getStagePotential  (const int& lane) const { return vec3(stagePotential.x[lane], stagePotential.y[lane], stagePotential.z[lane]); }
+		float getStageTotalEnergy(const int& lane) const { return stageTotalEnergy[lane]; }
+		void update(const float& dt)
+		{
+			const float accelerationFactor = -charge / mass;
+			LaneVectors k1, k2, k3, k4, l2, l3, l4, stagePosition;
+			potentialAt(position, stagePotential);
+			for(int lane = 0; lane < NUM_LANES; ++lane)
+			{
+				const float potentialLength = std::sqrt(stagePotential.x[lane] * stagePotential.x[lane] + stagePotential.y[lane] * stagePotential.y[lane] + stagePotential.z[lane] * stagePotential.z[lane]);
+				const float speedSquared    = velocity.x[lane] * velocity.x[lane] + velocity.y[lane] * velocity.y[lane] + velocity.z[lane] * velocity.z[lane];
+				stageTotalEnergy[lane] = charge * potentialLength + 0.5f * mass * speedSquared;
+			}
+			// k: velocity increments (accelerations * dt), l: position increments
+			step(LaneVectors(), stagePotential, dt * accelerationFactor, k1);
+			step(position, velocity, 0.5f * dt, stagePosition);
+			potentialAt(stagePosition, k2);
+			step(LaneVectors(), k2, dt * accelerationFactor, k2);
+			step(velocity, k1, 0.5f, l2);
+			step(position, l2, 0.5f * dt, stagePosition);
+			potentialAt(stagePosition, k3);
+			step(LaneVectors(), k3, dt * accelerationFactor, k3);
+			step(velocity, k2, 0.5f, l3);
+			step(position, l3, dt, stagePosition);
+			potentialAt(stagePosition, k4);
+			step(LaneVectors(), k4, dt * accelerationFactor, k4);
+			step(velocity, k3, 1.0f, l4);
+			const float oneOverSix = 1.0f / 6.0f;
+			for(int lane = 0; lane < NUM_LANES; ++lane)
+			{
+				const float mask = activeMask[lane] * oneOverSix;
+				position.x[lane] += mask * dt * (velocity.x[lane] + 2.0f * l2.x[lane] + 2.0f * l3.x[lane] + l4.x[lane]);
+				position.y[lane] += mask * dt * (velocity.y[lane] + 2.0f * l2.y[lane] + 2.0f * l3.y[lane] + l4.y[lane]);
+				position.z[lane] += mask * dt * (velocity.z[lane] + 2.0f * l2.z[lane] + 2.0f * l3.z[lane] + l4.z[lane]);
+				velocity.x[lane] += mask * (k1.x[lane] + 2.0f * k2.x[lane] + 2.0f * k3.x[lane] + k4.x[lane]);
+				velocity.y[lane] += mask * (k1.y[lane] + 2.0f * k2.y[lane] + 2.0f * k3.y[lane] + k4.y[lane]);
+				velocity.z[lane] += mask * (k1.z[lane] + 2.0f * k2.z[lane] + 2.0f * k3.z[lane] + k4.z[lane]);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef HISTOGRAM_ACCUMULATOR_H
+#define HISTOGRAM_ACCUMULATOR_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+// Lightweight, thread-independent 1D histogram with the same binning conventions as TH1D:
+// bin 0 is the underflow, bin numBins + 1 is the overflow bin.
+// Worker threads fill their own accumulators, that are added together in a fixed order
+// and then copied to the ROOT histograms by the main thread.
+class HistogramAccumulator
+{
+	private:
+		static constexpr int MAX_NUM_BINS = 1 << 24; // limit of the binary images read back
+		int                 numBins;
+		double              minRange;
+		double              maxRange;
+		double              numEntries = 0;
+		std::vector<double> binContents;
+		std::vector<double> binSumOfSquaredWeights;
+	public:
+		HistogramAccumulator(const int& numBinsArg, const double& minRangeArg, const double& maxRangeArg):
+			numBins(numBinsArg), minRange(minRangeArg), maxRange(maxRangeArg),
+			binContents(numBinsArg + 2, 0.0), binSumOfSquaredWeights(numBinsArg + 2, 0.0) {}
+		int    getNumBins()    const { return numBins;    }
+		double getMinRange()   const { return minRange;   }
+		double getMaxRange()   const { return maxRange;   }
+		double getNumEntries() const { return numEntries; }
+		double getBinContent(const int& bin) const { return binContents[bin]; }
+		double getBinError  (const int& bin) const { return std::sqrt(binSumOfSquaredWeights[bin]); }
+		void   setBinContent(const int& bin, const double& content) { binContents[bin] = content; }
+		void   setBinError  (const int& bin, const double& error) { binSumOfSquaredWeights[bin] = error * error; }
+		void   setNumEntries(const double& numEntriesArg) { numEntries = numEntriesArg; }
+		int findBin(const double& x) const
+		{
+			if(x <  minRange) return 0;
+			if(x >= maxRange) return numBins + 1;
+			return 1 + static_cast<int>((x - minRange) / (maxRange - minRange) * numBins);
+		}
+		void fill(const double& x, const double& weight = 1.0)
+		{
+			int bin = findBin(x);
+			binContents[bin]            += weight;
+			binSumOfSquaredWeights[bin] += weight * weight;
+			numEntries                  += 1;
+		}
+		void add(const HistogramAccumulator& other)
+		{
+			for(int bin = 0; bin < numBins + 2; ++bin)
+			{
+				binContents[bin]            += other.binContents[bin];
+				binSumOfSquaredWeights[bin] += other.binSumOfSquaredWeights[bin];
+			}
+			numEntries += other.numEntries;
+		}
+		void reset()
+		{
+			std::fill(binContents.begin(),            binContents.end(),            0.0);
+			std::fill(binSumOfSquaredWeights.begin(), binSumOfSquaredWeights.end(), 0.0);
+			numEntries = 0;
+		}
+		// Exact binary image of the histogram (e.g. for the result cache and the checkpoints), only the filled bins are
+		// written. read() takes over the binning of the image.
+		void write(std::ostream& stream) const
+		{
+			stream.write(reinterpret_cast<const char*>(&numBins),    sizeof(numBins));
+			stream.write(reinterpret_cast<const char*>(&minRange),   sizeof(minRange));
+			stream.write(reinterpret_cast<const char*>(&maxRange),   sizeof(maxRange));
+			stream.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+			auto isFilled = [this] (const int& bin) { return binContents[bin] != 0.0 || binSumOfSquaredWeights[bin] != 0.0; };
+			int numFilledBins = 0;
+			for(int bin = 0; bin < numBins + 2; ++bin) numFilledBins += isFilled(bin);
+			stream.write(reinterpret_cast<const char*>(&numFilledBins), sizeof(numFilledBins));
+			for(int bin = 0; bin < numBins + 2; ++bin)
+			{
+				if(!isFilled(bin)) continue;
+				stream.write(reinterpret_cast<const char*>(&bin),                         sizeof(bin));
+				stream.write(reinterpret_cast<const char*>(&binContents[bin]),            sizeof(double));
+				stream.write(reinterpret_cast<const char*>(&binSumOfSquaredWeights[bin]), sizeof(double));
+			}
+		}
+		bool read(std::istream& stream)
+		{
+			int numFilledBins = 0;
+			stream.read(reinterpret_cast<char*>(&numBins),       sizeof(numBins));
+			stream.read(reinterpret_cast<char*>(&minRange),      sizeof(minRange));
+			stream.read(reinterpret_cast<char*>(&maxRange),      sizeof(maxRange));
+			stream.read(reinterpret_cast<char*>(&numEntries),    sizeof(numEntries));
+			stream.read(reinterpret_cast<char*>(&numFilledBins), sizeof(numFilledBins));
+			// Bins beyond MAX_NUM_BINS or more filled bins than bins come from a corrupt image
+			if(!stream || numBins < 0 || MAX_NUM_BINS < numBins || numFilledBins < 0 || numBins + 2 < numFilledBins) return false;
+			binContents           .assign(numBins + 2, 0.0);
+			binSumOfSquaredWeights.assign(numBins + 2, 0.0);
+			for(int filledBin = 0; filledBin < numFilledBins; ++filledBin)
+			{
+				int bin = 0;
+				stream.read(reinterpret_cast<char*>(&bin), sizeof(bin));
+				if(!stream || bin < 0 || numBins + 1 < bin) return false;
+				stream.read(reinterpret_cast<char*>(&binContents[bin]),            sizeof(double));
+				stream.read(reinterpret_cast<char*>(&binSumOfSquaredWeights[bin]), sizeof(double));
+			}
+			return static_cast<bool>(stream);
+		}
+		// Multiplies the contents by factor, the errors scale with them
+		void scale(const double& factor)
+		{
+			for(int bin = 0; bin < numBins + 2; ++bin)
+			{
+				binContents[bin]            *= factor;
+				binSumOfSquaredWeights[bin] *= factor * factor;
+			}
+		}
+		// Works with TH1D-like histograms of the same binning
+		template <class Histogram>
+		void copyToHistogram(Histogram& histogram) const
+		{
+			for(int bin = 0; bin < numBins + 2; ++bin)
+			{
+				histogram.SetBinContent(bin, binContents[bin]);
+				histogram.SetBinError  (bin, getBinError(bin));
+			}
+			histogram.SetEntries(numEntries);
+		}
+		// Copies the contents to a single y row of a TH2D-like histogram of the same x binning
+		template <class Histogram>
+		void copyToHistogramRow(Histogram& histogram, const int& yBin) const
+		{
+			for(int bin = 0; bin < numBins + 2; ++bin)
+			{
+				histogram.SetBinContent(bin, yBin, binContents[bin]);
+				histogram.SetBinError  (bin, yBin, getBinError(bin));
+			}
+			histogram.SetEntries(histogram.GetEntries() + numEntries);
+		}
+};
+
+// Sum of independent replicate histograms (e.g. independent randomisations of a quasi-Monte Carlo
+// point set), with bin errors estimated from the spread of the replicates instead of from Poisson
+// statistics. Needs at least two replicates.
+HistogramAccumulator sumWithReplicateErrors(const std::vector<HistogramAccumulator>& replicates)
+{
+	HistogramAccumulator sum(replicates.front().getNumBins(), replicates.front().getMinRange(), replicates.front().getMaxRange());
+	for(const auto& replicate: replicates) sum.add(replicate);
+	const double numReplicates = replicates.size();
+	for(int bin = 0; bin < sum.getNumBins() + 2; ++bin)
+	{
+		const double mean = sum.getBinContent(bin) / numReplicates;
+		double sumOfSquaredDifferences = 0.0;
+		for(const auto& replicate: replicates)
+		{
+			sumOfSquaredDifferences += (replicate.getBinContent(bin) - mean) * (replicate.getBinContent(bin) - mean);
+		}
+		// Variance of the sum of the replicates: numReplicates * sample variance
+		sum.setBinError(bin, std::sqrt(numReplicates * sumOfSquaredDifferences / (numReplicates - 1)));
+	}
+	return sum;
+}
+
+// Student t 97.5% quantile, the factor of the two-sided 95% confidence interval of a mean whose error is
+// estimated from degreesOfFreedom + 1 replicates. Tabulated up to 30 degrees of freedom, above that the
+// Cornish-Fisher expansion around the normal quantile (error below 1e-4). Errors that are not estimated
+// from replicates (zero degrees of freedom) use the normal quantile.
+double studentTQuantile975(const int& degreesOfFreedom)
+{
+	static const double table[] = {12.7062, 4.3027, 3.1824, 2.7764, 2.5706, 2.4469, 2.3646, 2.3060, 2.2622, 2.2281,
+	                                2.2010, 2.1788, 2.1604, 2.1448, 2.1314, 2.1199, 2.1098, 2.1009, 2.0930, 2.0860,
+	                                2.0796, 2.0739, 2.0687, 2.0639, 2.0595, 2.0555, 2.0518, 2.0484, 2.0452, 2.0423};
+	const double normalQuantile = 1.959964;
+	if(degreesOfFreedom <= 0) return normalQuantile;
+	if(degreesOfFreedom <= 30) return table[degreesOfFreedom - 1];
+	const double z = normalQuantile;
+	const double n = degreesOfFreedom;
+	return z + (z * z * z + z) / (4.0 * n) + (5.0 * std::pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * n * n)
+		+ (3.0 * std::pow(z, 7) + 19.0 * std::pow(z, 5) + 17.0 * z * z * z - 15.0 * z) / (384.0 * n * n * n);
+}
+
+// Average of a histogram and its mirror image x -> -x, for distributions known to be symmetric (e.g. sampled
+// on half of a mirror symmetric setup). The range must be symmetric around 0: bin b is mirrored to bin
+// numBins + 1 - b, the underflow to the overflow. mirrorCovariances[b] is the covariance of the contents of
+// bin b and its mirror bin. Without them the two are taken as uncorrelated, which is exact or conservative for
+// sums of experiments that fill a single bin each (their bins are anticorrelated), not for estimates that
+// share their errors between the bins (e.g. differences of coupled experiments or interpolated maps).
+HistogramAccumulator mirrorSymmetrized(const HistogramAccumulator& histogram, const std::vector<double>& mirrorCovariances = std::vector<double>())
+{
+	HistogramAccumulator symmetrized(histogram);
+	const int numBins = histogram.getNumBins();
+	for(int bin = 0; bin < numBins + 2; ++bin)
+	{
+		const int mirrorBin = numBins + 1 - bin;
+		const double variance       = histogram.getBinError(bin)       * histogram.getBinError(bin);
+		const double mirrorVariance = histogram.getBinError(mirrorBin) * histogram.getBinError(mirrorBin);
+		// The middle bin of an odd number of bins is its own mirror image
+		const double covariance     = mirrorCovariances.empty() ? (bin == mirrorBin ? variance : 0.0) : mirrorCovariances[bin];
+		symmetrized.setBinContent(bin, 0.5 * (histogram.getBinContent(bin) + histogram.getBinContent(mirrorBin)));
+		symmetrized.setBinError  (bin, 0.5 * std::sqrt(std::max(0.0, variance + mirrorVariance + 2.0 * covariance)));
+	}
+	return symmetrized;
+}
+
+#endif
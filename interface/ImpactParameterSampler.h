@@ -0,0 +1,94 @@
+#ifndef IMPACT_PARAMETER_SAMPLER_H
+#define IMPACT_PARAMETER_SAMPLER_H
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+// Maps a uniform [0, 1) number to a start position in [minX, maxX) with a weight, combining
+//  - stratification: the experiments are dealt out to numStrata equal probability strata in turn,
+//  - antithetic pairs: the second experiment of a pair uses the mirrored number 1 - u, which
+//    is the mirrored position -x when the range and the density are symmetric,
+//  - importance sampling: positions are drawn from a user-defined (unnormalized) density,
+//    tabulated on numDensityBins bins, and weighted by uniform density / sampling density.
+// A sample (replicate) consists of numSlots experiments. When the strata do not get the same number
+// of experiments, the weights also correct for the unequal allocation, so the weights are exactly 1
+// only for uniform sampling with every stratum filled equally.
+// Experiments whose sample is rejected (e.g. absorbed electrons) are repeated with retry(): uniform over the
+// whole range, not in the stratum or with the density of the rejected sample, and with the weight of the
+// rejected sample. A rejected sample then stands for the accepted distribution itself, so the weighted sum
+// estimates the accepted distribution without bias for any strata and density.
+class ImpactParameterSampler
+{
+	public:
+		using Density = std::function<double(const double& x)>;
+		struct Sample
+		{
+			double x;
+			double weight;
+		};
+	private:
+		double              minX;
+		double              maxX;
+		int                 numStrata;
+		int                 useAntitheticPairs;
+		std::vector<double> stratumWeights;
+		std::vector<double> densityCumulative; // empty: uniform sampling
+		double              densityBinWidth = 0.0;
+	public:
+		ImpactParameterSampler(const double& minXArg, const double& maxXArg, const int& numSlots, const int& numStrataArg, const int& useAntitheticPairsArg, const Density& density = Density(), const int& numDensityBins = 1024):
+			minX(minXArg), maxX(maxXArg), numStrata(numStrataArg), useAntitheticPairs(useAntitheticPairsArg), stratumWeights(numStrataArg, 0.0)
+		{
+			if(numStrata < 1 || numSlots < numStrata) throw std::invalid_argument("the number of strata must be positive and at most the number of experiments");
+			for(int slot = 0; slot < numSlots; ++slot) stratumWeights[stratum(slot)] += 1.0;
+			for(auto& weight: stratumWeights) weight = numSlots / (numStrata * weight);
+			if(!density) return;
+			densityBinWidth = (maxX - minX) / numDensityBins;
+			densityCumulative.push_back(0.0);
+			for(int bin = 0; bin < numDensityBins; ++bin)
+			{
+				double binDensity = density(minX + (bin + 0.5) * densityBinWidth);
+				if(binDensity <= 0.0) throw std::invalid_argument("the importance density must be positive on the whole range");
+				densityCumulative.push_back(densityCumulative.back() + binDensity);
+			}
+			for(auto& cumulative: densityCumulative) cumulative /= densityCumulative.back();
+		}
+		// Index of the experiment whose random number the given experiment uses on its first attempt
+		int randomNumberSourceSlot(const int& slot) const
+		{
+			return useAntitheticPairs ? slot - slot % 2 : slot;
+		}
+		int stratum(const int& slot) const
+		{
+			if(!useAntitheticPairs) return slot % numStrata;
+			const int pairStratum = (slot / 2) % numStrata;
+			return slot % 2 == 0 ? pairStratum : numStrata - 1 - pairStratum;
+		}
+		// slot: index of the experiment inside its sample (replicate)
+		Sample sample(const double& u, const int& slot) const
+		{
+			const int pairStratum = (useAntitheticPairs ? slot / 2 : slot) % numStrata;
+			double stratifiedU = (pairStratum + u) / numStrata;
+			if(useAntitheticPairs && slot % 2 == 1) stratifiedU = 1.0 - stratifiedU;
+			const double stratumWeight = stratumWeights[stratum(slot)];
+			if(densityCumulative.empty())
+			{
+				return Sample{minX + stratifiedU * (maxX - minX), stratumWeight};
+			}
+			// Inverse of the piecewise linear cumulative distribution
+			auto upper = std::upper_bound(densityCumulative.begin(), densityCumulative.end(), stratifiedU);
+			const int bin = std::min(static_cast<int>(densityCumulative.size()) - 2, std::max(0, static_cast<int>(upper - densityCumulative.begin()) - 1));
+			const double binProbability = densityCumulative[bin + 1] - densityCumulative[bin];
+			const double x = minX + (bin + (stratifiedU - densityCumulative[bin]) / binProbability) * densityBinWidth;
+			const double samplingDensity = binProbability / densityBinWidth;
+			return Sample{x, stratumWeight / ((maxX - minX) * samplingDensity)};
+		}
+		// Repetition of a rejected sample of the given weight
+		Sample retry(const double& u, const double& rejectedWeight) const
+		{
+			return Sample{minX + u * (maxX - minX), rejectedWeight};
+		}
+};
+
+#endif
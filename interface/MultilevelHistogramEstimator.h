@@ -0,0 +1,164 @@
+#ifndef MULTILEVEL_HISTOGRAM_ESTIMATOR_H
+#define MULTILEVEL_HISTOGRAM_ESTIMATOR_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "HistogramAccumulator.h"
+
+// Sums of the samples of a single level of a multilevel Monte Carlo estimate of a histogram.
+// On level 0 a sample is the histogram of a single coarse experiment, on a level l > 0 it is the
+// difference of the histograms of a fine and a coarse experiment run from the same start conditions.
+// A sample is non-zero in at most two bins, so the per-bin sums of squares are exact. The products of the
+// sample in a bin and in its mirror bin (numBins + 1 - bin) give the covariances needed to symmetrize the
+// estimate: the fine and the coarse hit of a difference often land in mirror bins.
+class LevelDifferenceAccumulator
+{
+	private:
+		HistogramAccumulator binning;
+		long long            numSamples = 0;
+		double               totalCost  = 0.0;
+		std::vector<double>  sums;
+		std::vector<double>  sumsOfSquares;
+		std::vector<double>  sumsOfMirrorProducts;
+		int mirrorBin(const int& bin) const { return binning.getNumBins() + 1 - bin; }
+	public:
+		LevelDifferenceAccumulator(const int& numBins, const double& minRange, const double& maxRange):
+			binning(numBins, minRange, maxRange), sums(numBins + 2, 0.0), sumsOfSquares(numBins + 2, 0.0), sumsOfMirrorProducts(numBins + 2, 0.0) {}
+		long long getNumSamples() const { return numSamples; }
+		double    getMeanCost()   const { return numSamples == 0 ? 0.0 : totalCost / numSamples; }
+		double    getMean    (const int& bin) const { return numSamples == 0 ? 0.0 : sums[bin] / numSamples; }
+		// Sample variance of the level in the given bin
+		double    getVariance(const int& bin) const
+		{
+			if(numSamples < 2) return 0.0;
+			const double mean = getMean(bin);
+			return std::max(0.0, (sumsOfSquares[bin] - numSamples * mean * mean) / (numSamples - 1));
+		}
+		// Sample covariance of the level in the given bin and its mirror bin
+		double    getMirrorCovariance(const int& bin) const
+		{
+			if(numSamples < 2) return 0.0;
+			return (sumsOfMirrorProducts[bin] - numSamples * getMean(bin) * getMean(mirrorBin(bin))) / (numSamples - 1);
+		}
+		// Sum of the bin variances: variance of the histogram of a single sample in the L2 norm
+		double    getTotalVariance() const
+		{
+			double variance = 0.0;
+			for(int bin = 0; bin < static_cast<int>(sums.size()); ++bin) variance += getVariance(bin);
+			return variance;
+		}
+		// L2 norm of the mean, on the finest level this measures the time step bias that is left
+		double    getMeanNorm() const
+		{
+			double squaredNorm = 0.0;
+			for(int bin = 0; bin < static_cast<int>(sums.size()); ++bin) squaredNorm += getMean(bin) * getMean(bin);
+			return std::sqrt(squaredNorm);
+		}
+		// Level 0 samples have no coarse hit
+		void addSample(const double& fineX, const bool& hasCoarse, const double& coarseX, const double& weight, const double& cost)
+		{
+			++numSamples;
+			totalCost += cost;
+			const int fineBin = binning.findBin(fineX);
+			if(!hasCoarse)
+			{
+				sums[fineBin]          += weight;
+				sumsOfSquares[fineBin] += weight * weight;
+				if(mirrorBin(fineBin) == fineBin) sumsOfMirrorProducts[fineBin] += weight * weight;
+				return;
+			}
+			const int coarseBin = binning.findBin(coarseX);
+			if(fineBin == coarseBin) return;
+			sums[fineBin]            += weight;
+			sumsOfSquares[fineBin]   += weight * weight;
+			sums[coarseBin]          -= weight;
+			sumsOfSquares[coarseBin] += weight * weight;
+			if(mirrorBin(fineBin) == fineBin)     sumsOfMirrorProducts[fineBin]   += weight * weight;
+			if(mirrorBin(coarseBin) == coarseBin) sumsOfMirrorProducts[coarseBin] += weight * weight;
+			if(mirrorBin(fineBin) == coarseBin)
+			{
+				sumsOfMirrorProducts[fineBin]   -= weight * weight;
+				sumsOfMirrorProducts[coarseBin] -= weight * weight;
+			}
+		}
+		void add(const LevelDifferenceAccumulator& other)
+		{
+			numSamples += other.numSamples;
+			totalCost  += other.totalCost;
+			for(int bin = 0; bin < static_cast<int>(sums.size()); ++bin)
+			{
+				sums[bin]                 += other.sums[bin];
+				sumsOfSquares[bin]        += other.sumsOfSquares[bin];
+				sumsOfMirrorProducts[bin] += other.sumsOfMirrorProducts[bin];
+			}
+		}
+		const HistogramAccumulator& getBinning() const { return binning; }
+};
+
+// Multilevel Monte Carlo estimate of the expected histogram of a single experiment (Giles, Oper. Res. 56, 2008):
+// the sum of the level means, with the variance sum_l V_l / N_l. For a target variance the cost is
+// minimal with N_l ~ sqrt(V_l / C_l), where C_l is the cost of a sample of level l.
+class MultilevelHistogramEstimator
+{
+	private:
+		std::vector<LevelDifferenceAccumulator> levels;
+	public:
+		MultilevelHistogramEstimator(const int& numLevels, const int& numBins, const double& minRange, const double& maxRange):
+			levels(numLevels, LevelDifferenceAccumulator(numBins, minRange, maxRange)) {}
+		int getNumLevels() const { return levels.size(); }
+		LevelDifferenceAccumulator&       getLevel(const int& level)       { return levels[level]; }
+		const LevelDifferenceAccumulator& getLevel(const int& level) const { return levels[level]; }
+		// Number of samples needed on each level for the target variance of the estimate (never less than done)
+		std::vector<long long> optimalNumSamples(const double& targetVariance) const
+		{
+			double sumOfSqrtVarianceCost = 0.0;
+			for(const auto& level: levels) sumOfSqrtVarianceCost += std::sqrt(level.getTotalVariance() * level.getMeanCost());
+			std::vector<long long> numSamples;
+			for(const auto& level: levels)
+			{
+				const double cost    = std::max(level.getMeanCost(), 1e-12);
+				const double optimal = std::ceil(std::sqrt(level.getTotalVariance() / cost) * sumOfSqrtVarianceCost / targetVariance);
+				numSamples.push_back(std::max(level.getNumSamples(), static_cast<long long>(optimal)));
+			}
+			return numSamples;
+		}
+		// Bin contents and errors of the estimate, multiplied by scale (e.g. a number of experiments)
+		HistogramAccumulator estimate(const double& scale) const
+		{
+			const HistogramAccumulator& binning = levels.front().getBinning();
+			HistogramAccumulator result(binning.getNumBins(), binning.getMinRange(), binning.getMaxRange());
+			for(int bin = 0; bin < binning.getNumBins() + 2; ++bin)
+			{
+				double mean     = 0.0;
+				double variance = 0.0;
+				for(const auto& level: levels)
+				{
+					if(level.getNumSamples() == 0) continue;
+					mean     += level.getMean(bin);
+					variance += level.getVariance(bin) / level.getNumSamples();
+				}
+				result.setBinContent(bin, scale * mean);
+				result.setBinError  (bin, scale * std::sqrt(variance));
+			}
+			result.setNumEntries(scale);
+			return result;
+		}
+		// Covariances of the bins of estimate(scale) with their mirror bins, for mirrorSymmetrized()
+		std::vector<double> mirrorCovariances(const double& scale) const
+		{
+			std::vector<double> covariances(levels.front().getBinning().getNumBins() + 2, 0.0);
+			for(int bin = 0; bin < static_cast<int>(covariances.size()); ++bin)
+			{
+				for(const auto& level: levels)
+				{
+					if(level.getNumSamples() == 0) continue;
+					covariances[bin] += scale * scale * level.getMirrorCovariance(bin) / level.getNumSamples();
+				}
+			}
+			return covariances;
+		}
+};
+
+#endif
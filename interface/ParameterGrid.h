@@ -0,0 +1,58 @@
+#ifndef PARAMETER_GRID_H
+#define PARAMETER_GRID_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+
+// Cartesian product of parameter axes, e.g. number of protons x proton-proton distance x start energy.
+// The points are numbered with the last axis running fastest, so the points sharing the values of the
+// first axes (e.g. the same geometry) are consecutive.
+class ParameterGrid
+{
+	public:
+		struct Axis
+		{
+			std::string         name;
+			std::vector<double> values;
+		};
+	private:
+		std::vector<Axis> axes;
+	public:
+		ParameterGrid(const std::vector<Axis>& axesArg): axes(axesArg) {}
+		int getNumAxes() const { return axes.size(); }
+		const Axis& getAxis(const int& axis) const { return axes[axis]; }
+		// Number of points spanned by the axes [firstAxis, getNumAxes())
+		int getNumPoints(const int& firstAxis = 0) const
+		{
+			int numPoints = 1;
+			for(int axis = firstAxis; axis < getNumAxes(); ++axis) numPoints *= axes[axis].values.size();
+			return numPoints;
+		}
+		int getAxisIndex(const int& pointIndex, const int& axis) const
+		{
+			return pointIndex / getNumPoints(axis + 1) % axes[axis].values.size();
+		}
+		double getValue(const int& pointIndex, const int& axis) const
+		{
+			return axes[axis].values[getAxisIndex(pointIndex, axis)];
+		}
+		// Index of the point among the points that differ only in the axes [numAxes, getNumAxes())
+		int getSliceIndex(const int& pointIndex, const int& numAxes) const
+		{
+			return pointIndex / getNumPoints(numAxes);
+		}
+		// "name0_value0_name1_value1..." of the first numAxes axes of a point, usable as a histogram name
+		std::string getPointName(const int& pointIndex, const int& numAxes) const
+		{
+			std::ostringstream name;
+			for(int axis = 0; axis < numAxes; ++axis)
+			{
+				if(0 < axis) name << "_";
+				name << axes[axis].name << "_" << getValue(pointIndex, axis);
+			}
+			return name.str();
+		}
+};
+
+#endif
@@ -155,9 +155,10 @@ class Particle: public Drawable
 		}
 		virtual void calculateForceFromPotential(const vec3& potential) = 0;
 		virtual float calculatePotentialEnergy(const vec3& potential) const = 0;
-		static std::vector<std::shared_ptr<Particle>> particleCollection;
+		// Every thread has its own collection, so independent experiments can run in parallel
+		static thread_local std::vector<std::shared_ptr<Particle>> particleCollection;
 };
 
-std::vector<std::shared_ptr<Particle>> Particle::particleCollection;
+thread_local std::vector<std::shared_ptr<Particle>> Particle::particleCollection;
 
 #endif
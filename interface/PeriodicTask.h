@@ -0,0 +1,49 @@
+#ifndef PERIODIC_TASK_H
+#define PERIODIC_TASK_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+// Calls a task on its own thread every intervalSeconds until it is stopped (or destroyed), e.g. to write
+// checkpoints of a running computation without stalling its worker threads. A task in progress is
+// finished by stop(), a pending one is not started.
+class PeriodicTask
+{
+	private:
+		std::function<void()>   task;
+		double                  intervalSeconds;
+		std::mutex              stopMutex;
+		std::condition_variable stopCondition;
+		bool                    stopRequested = false;
+		std::thread             thread;
+		void loop()
+		{
+			std::unique_lock<std::mutex> lock(stopMutex);
+			while(!stopCondition.wait_for(lock, std::chrono::duration<double>(intervalSeconds), [this] { return stopRequested; }))
+			{
+				lock.unlock();
+				task();
+				lock.lock();
+			}
+		}
+	public:
+		PeriodicTask(const double& intervalSecondsArg, const std::function<void()>& taskArg):
+			task(taskArg), intervalSeconds(intervalSecondsArg), thread(&PeriodicTask::loop, this) {}
+		PeriodicTask(const PeriodicTask&) = delete;
+		PeriodicTask& operator=(const PeriodicTask&) = delete;
+		~PeriodicTask() { stop(); }
+		void stop()
+		{
+			{
+				std::unique_lock<std::mutex> lock(stopMutex);
+				stopRequested = true;
+			}
+			stopCondition.notify_all();
+			if(thread.joinable()) thread.join();
+		}
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef PHILOX_RANDOM_H
+#define PHILOX_RANDOM_H
+
+#include <cstdint>
+#include <array>
+
+// Counter-based random number generator (Philox4x32-10, Salmon et al., SC'11).
+// The output is a pure function of (key, counter): the key is the run seed, the upper
+// half of the counter is the stream (e.g. measurement point and experiment number), the
+// lower half counts the 4 x 32 bit blocks drawn from the stream. Any stream can therefore
+// be reproduced on its own, without generating the streams before it, and streams
+// can be generated on any number of threads independently.
+class PhiloxRandom
+{
+	public:
+		using Block = std::array<std::uint32_t, 4>;
+	private:
+		static constexpr std::uint32_t MULTIPLIER_0 = 0xD2511F53u;
+		static constexpr std::uint32_t MULTIPLIER_1 = 0xCD9E8D57u;
+		static constexpr std::uint32_t WEYL_0       = 0x9E3779B9u;
+		static constexpr std::uint32_t WEYL_1       = 0xBB67AE85u;
+		static constexpr int           NUM_ROUNDS   = 10;
+		std::uint32_t key[2];
+		std::uint32_t stream[2];
+		std::uint64_t blockIndex    = 0;
+		Block         buffer;
+		int           numBufferUsed = 4;
+	public:
+		PhiloxRandom(const std::uint64_t& seed, const std::uint32_t& streamHigh, const std::uint32_t& streamLow)
+		{
+			key[0]    = static_cast<std::uint32_t>(seed);
+			key[1]    = static_cast<std::uint32_t>(seed >> 32);
+			stream[0] = streamLow;
+			stream[1] = streamHigh;
+		}
+		// The index-th block of the stream, independent of the state of the generator
+		Block generateBlock(const std::uint64_t& index) const
+		{
+			std::uint32_t counter[4] = { static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), stream[0], stream[1] };
+			std::uint32_t roundKey[2] = { key[0], key[1] };
+			for(int round = 0; round < NUM_ROUNDS; ++round)
+			{
+				std::uint64_t product0 = static_cast<std::uint64_t>(MULTIPLIER_0) * counter[0];
+				std::uint64_t product1 = static_cast<std::uint64_t>(MULTIPLIER_1) * counter[2];
+				std::uint32_t newCounter[4] =
+				{
+					static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ roundKey[0],
+					static_cast<std::uint32_t>(product1),
+					static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ roundKey[1],
+					static_cast<std::uint32_t>(product0)
+				};
+				for(int word = 0; word < 4; ++word) counter[word] = newCounter[word];
+				roundKey[0] += WEYL_0;
+				roundKey[1] += WEYL_1;
+			}
+			return Block{{ counter[0], counter[1], counter[2], counter[3] }};
+		}
+		std::uint32_t nextUInt32()
+		{
+			if(numBufferUsed == 4)
+			{
+				buffer        = generateBlock(blockIndex++);
+				numBufferUsed = 0;
+			}
+			return buffer[numBufferUsed++];
+		}
+		// Uniform in [0, 1) with 53 random bits
+		double uniform()
+		{
+			std::uint64_t high = nextUInt32() >> 5;
+			std::uint64_t low  = nextUInt32() >> 6;
+			return (high * 67108864.0 + low) * (1.0 / 9007199254740992.0);
+		}
+		// Fills numSamples uniform [0, 1) values. Whole blocks are converted at once, the
+		// loop has no dependency between blocks so it can be vectorized by the compiler.
+		// Continues the stream exactly like successive uniform() calls would.
+		void fillUniform(double* samples, const int& numSamples)
+		{
+			int sampleIndex = 0;
+			while(sampleIndex < numSamples && numBufferUsed != 4) samples[sampleIndex++] = uniform();
+			const int numWholeBlocks = (numSamples - sampleIndex) / 2;
+			for(int block = 0; block < numWholeBlocks; ++block)
+			{
+				Block words = generateBlock(blockIndex + block);
+				samples[sampleIndex + 2 * block]     = ((words[0] >> 5) * 67108864.0 + (words[1] >> 6)) * (1.0 / 9007199254740992.0);
+				samples[sampleIndex + 2 * block + 1] = ((words[2] >> 5) * 67108864.0 + (words[3] >> 6)) * (1.0 / 9007199254740992.0);
+			}
+			blockIndex  += numWholeBlocks;
+			sampleIndex += 2 * numWholeBlocks;
+			while(sampleIndex < numSamples) samples[sampleIndex++] = uniform();
+		}
+};
+
+constexpr std::uint32_t PhiloxRandom::MULTIPLIER_0;
+constexpr std::uint32_t PhiloxRandom::MULTIPLIER_1;
+constexpr std::uint32_t PhiloxRandom::WEYL_0;
+constexpr std::uint32_t PhiloxRandom::WEYL_1;
+constexpr int           PhiloxRandom::NUM_ROUNDS;
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <type_traits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "HistogramAccumulator.h"
+#include "ControlVariateAccumulator.h"
+#include "BinarySerialization.h"
+
+// 64 bit FNV-1a hash of named configuration values, fed in a fixed order. The values are hashed by their
+// bit patterns, so any change of a parameter, however small, gives a new key.
+class ConfigurationHash
+{
+	private:
+		std::uint64_t hash = 14695981039346656037ull;
+		void addBytes(const void* data, const std::size_t& size)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for(std::size_t index = 0; index < size; ++index)
+			{
+				hash ^= bytes[index];
+				hash *= 1099511628211ull;
+			}
+		}
+		void addName(const std::string& name)
+		{
+			addBytes(name.c_str(), name.size() + 1);
+		}
+	public:
+		template <class T>
+		ConfigurationHash& add(const std::string& name, const T& value)
+		{
+			static_assert(std::is_arithmetic<T>::value, "Only numbers, strings and vectors of numbers can be hashed.");
+			addName(name);
+			addBytes(&value, sizeof(value));
+			return *this;
+		}
+		template <class T>
+		ConfigurationHash& add(const std::string& name, const std::vector<T>& values)
+		{
+			add(name + ".size", values.size());
+			for(const auto& value: values) add(name, value);
+			return *this;
+		}
+		ConfigurationHash& add(const std::string& name, const std::string& value)
+		{
+			addName(name);
+			addName(value);
+			return *this;
+		}
+		ConfigurationHash& add(const std::string& name, const char* value)
+		{
+			return add(name, std::string(value));
+		}
+		std::string getKey() const
+		{
+			std::ostringstream key;
+			key << std::hex << std::setw(16) << std::setfill('0') << hash;
+			return key.str();
+		}
+};
+
+// Merged results of a measurement point as stored in the cache
+struct CachedMeasurementPoint
+{
+	int                                    numExperiments    = 0;
+	long long                              totalNumUpdates   = 0;
+	int                                    electronsAbsorbed = 0;
+	long long                              startsRejected    = 0;
+	double                                 relativePrecision = 0.0;
+	std::vector<HistogramAccumulator>      electronPositionsXReplicates;
+	std::vector<ControlVariateAccumulator> modelControlReplicates;
+	std::vector<double>                    modelHitProbabilities;
+	std::vector<HistogramAccumulator>      observableHistograms;
+};
+
+// Directory of result files named by the configuration keys. A changed configuration gets a new key,
+// so entries are never invalidated, only left unused. Entries are written to a temporary file that is
+// renamed over the entry, so a concurrent or interrupted run never leaves a half written entry.
+class ResultCache
+{
+	private:
+		static constexpr std::uint32_t fileFormat = 0x52430002; // "RC", version 2
+		std::string directory;
+		std::string entryPath(const std::string& key) const { return directory + "/" + key + ".bin"; }
+	public:
+		ResultCache(const std::string& directoryArg): directory(directoryArg)
+		{
+			mkdir(directory.c_str(), 0755);
+		}
+		// Returns false if there is no (complete) entry of the key
+		bool load(const std::string& key, CachedMeasurementPoint& point) const
+		{
+			std::ifstream stream(entryPath(key), std::ios::binary);
+			std::uint32_t format = 0;
+			if(!readValue(stream, format) || format != fileFormat) return false;
+			CachedMeasurementPoint loaded;
+			const bool complete =
+				readValue(stream, loaded.numExperiments) && readValue(stream, loaded.totalNumUpdates) && readValue(stream, loaded.electronsAbsorbed) &&
+				readValue(stream, loaded.startsRejected) && readValue(stream, loaded.relativePrecision) &&
+				readObjects(stream, loaded.electronPositionsXReplicates, HistogramAccumulator(0, 0.0, 1.0)) &&
+				readObjects(stream, loaded.modelControlReplicates, ControlVariateAccumulator(0, 0.0, 1.0)) &&
+				readValues(stream, loaded.modelHitProbabilities) &&
+				readObjects(stream, loaded.observableHistograms, HistogramAccumulator(0, 0.0, 1.0));
+			if(!complete) return false;
+			point = loaded;
+			return true;
+		}
+		bool store(const std::string& key, const CachedMeasurementPoint& point) const
+		{
+			const std::string temporaryPath = entryPath(key) + ".tmp" + std::to_string(getpid());
+			{
+				std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+				writeValue(stream, static_cast<std::uint32_t>(fileFormat));
+				writeValue(stream, point.numExperiments);
+				writeValue(stream, point.totalNumUpdates);
+				writeValue(stream, point.electronsAbsorbed);
+				writeValue(stream, point.startsRejected);
+				writeValue(stream, point.relativePrecision);
+				writeObjects(stream, point.electronPositionsXReplicates);
+				writeObjects(stream, point.modelControlReplicates);
+				writeValues (stream, point.modelHitProbabilities);
+				writeObjects(stream, point.observableHistograms);
+				if(!stream)
+				{
+					std::remove(temporaryPath.c_str());
+					return false;
+				}
+			}
+			return std::rename(temporaryPath.c_str(), entryPath(key).c_str()) == 0;
+		}
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef SCATTERING_EXPERIMENT_H
+#define SCATTERING_EXPERIMENT_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Electron.h"
+#include "Proton.h"
+#include "TargetGeometry.h"
+
+using glm::vec3;
+
+// An electron scattered on fixed charges, the experiment loop shared by the drivers. An experiment is put together from
+//  - the target geometry: the TargetGeometry or the proton positions given to the constructor,
+//  - the beam source: the start position and velocity of the electron given to init(),
+//  - the integrator: a functor advancing the electron by the time step given to run(), RungeKutta4Integrator by default,
+//  - the termination criteria: a functor of the electron and the number of updates returning the Outcome of the step,
+//  - the detector sinks: a functor called after every step with the electron and its state before the step.
+// The integrator, criteria and sinks are template parameters, so they are inlined into the loop.
+// ElectronBundle and ElectronBunch integrate many electrons at once as structures of arrays with their own
+// Runge-Kutta 4 steps, they do not run through this loop.
+// The particles live in the calling thread's particle collections: they are built by the first init() of a thread
+// and kept for the following experiments, init() only resets the target and the electron's state.
+// The charges of a TargetGeometry are a field of the electron, read from the arrays shared by the threads (of a NUMA node):
+// a thread only builds its electron, whatever the size of the target. With targetParticles (and for proton positions) every thread
+// builds a Proton particle per charge instead, e.g. to display them.
+class ScatteringExperiment
+{
+	public:
+		enum Outcome { RUNNING, HIT, ABSORBED };
+		struct Result
+		{
+			vec3    hitPosition; // electron position at the end of the experiment
+			int     numUpdates;
+			Outcome outcome;
+		};
+		// Ends the experiment when the electron passes below the plane y = endPlaneY
+		struct EndPlaneTermination
+		{
+			float endPlaneY;
+			Outcome operator()(const ChargedParticle& electron, const int&) const
+			{
+				return electron.getPosition().y < endPlaneY ? HIT : RUNNING;
+			}
+		};
+		struct NoSink
+		{
+			void operator()(const ChargedParticle&, const vec3&, const vec3&, const int&) const {}
+		};
+		// ChargedParticle::update(): Runge-Kutta 4 in the field of the thread's particle collection and the external charges.
+		// update() evaluates the field at its four stages itself, the force member of the particle is not used.
+		struct RungeKutta4Integrator
+		{
+			void operator()(ChargedParticle& electron, const float& dt) const
+			{
+				electron.update(dt);
+			}
+		};
+	private:
+		TargetGeometry target;
+		bool           targetParticles;
+		unsigned int numThreadParticles() const { return targetParticles ? target.getNumCharges() + 1 : 1; }
+	public:
+		ScatteringExperiment(const TargetGeometry& targetArg, const bool& targetParticlesArg = false): target(targetArg), targetParticles(targetParticlesArg) {}
+		ScatteringExperiment(const std::vector<vec3>& protonPositions): ScatteringExperiment(TargetGeometry::fromPositions(protonPositions, Proton::protonCharge, "protons"), true) {}
+		const TargetGeometry& getTarget() const { return target; }
+		// The electron of the calling thread, after init()
+		ChargedParticle& getElectron() const { return *ChargedParticle::chargedParticleCollection[numThreadParticles() - 1]; }
+		void init(const vec3& electronPosition, const vec3& electronVelocity) const
+		{
+			if(ChargedParticle::chargedParticleCollection.size() != numThreadParticles())
+			{
+				clear();
+				for(unsigned int chargeIndex = 0; chargeIndex + 1 < numThreadParticles(); ++chargeIndex)
+				{
+					new Proton();
+				}
+				new Electron();
+			}
+			for(unsigned int chargeIndex = 0; chargeIndex + 1 < numThreadParticles(); ++chargeIndex)
+			{
+				ChargedParticle::chargedParticleCollection[chargeIndex] -> setPosition(target.getPositions()[chargeIndex]);
+				ChargedParticle::chargedParticleCollection[chargeIndex] -> setCharge(target.getCharges()[chargeIndex]);
+			}
+			if(targetParticles) getElectron().setExternalCharges(nullptr, nullptr, 0);
+			else
+			{
+				const TargetGeometry localTarget = target.getNodeLocal();
+				getElectron().setExternalCharges(localTarget.getPositions(), localTarget.getCharges(), localTarget.getNumCharges());
+			}
+			getElectron().setPosition(electronPosition);
+			getElectron().setVelocity(electronVelocity);
+		}
+		// Updates the electron with integrate() until terminate() returns an outcome other than RUNNING
+		template <class Termination, class Sink = NoSink, class Integrator = RungeKutta4Integrator>
+		Result run(const float& dt, Termination terminate, Sink sink = Sink(), Integrator integrate = Integrator()) const
+		{
+			ChargedParticle& electron = getElectron();
+			int numUpdates = 0;
+			while(1)
+			{
+				numUpdates++;
+				const vec3 previousPosition = electron.getPosition();
+				const vec3 previousVelocity = electron.getVelocity();
+				integrate(electron, dt);
+				sink(electron, previousPosition, previousVelocity, numUpdates);
+				const Outcome outcome = terminate(electron, numUpdates);
+				if(outcome != RUNNING) return Result{electron.getPosition(), numUpdates, outcome};
+			}
+		}
+		// Deletes the particles of the calling thread
+		static void clear()
+		{
+			Particle::particleCollection.clear();
+			ChargedParticle::chargedParticleCollection.clear();
+		}
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SOBOL_SEQUENCE_H
+#define SOBOL_SEQUENCE_H
+
+#include <cstdint>
+#include <array>
+#include <stdexcept>
+
+// Owen-scrambled Sobol sequence for quasi-Monte Carlo sampling.
+// Direction numbers are the first dimensions of Joe and Kuo (new-joe-kuo-6.21201).
+// The scrambling is the hash based nested uniform scrambling of Burley (JCGT 2020), a
+// different seed gives an independent randomisation of the same low-discrepancy point set,
+// so error estimates can be taken from the spread of a few randomisations.
+// Points are computed by index, so any point can be regenerated on its own.
+class SobolSequence
+{
+	public:
+		static constexpr int MAX_DIMENSIONS = 7;
+		static constexpr int NUM_BITS       = 32;
+	private:
+		using DirectionNumbers = std::array<std::array<std::uint32_t, NUM_BITS>, MAX_DIMENSIONS>;
+		std::array<std::uint32_t, MAX_DIMENSIONS> dimensionSeeds;
+		static const DirectionNumbers& directionNumbers()
+		{
+			static const DirectionNumbers numbers = calculateDirectionNumbers();
+			return numbers;
+		}
+		static DirectionNumbers calculateDirectionNumbers()
+		{
+			// Degree, coefficients and initial direction numbers of dimensions 2, 3, ...
+			struct PrimitivePolynomial { int degree; std::uint32_t coefficients; std::uint32_t initialNumbers[4]; };
+			static const PrimitivePolynomial polynomials[MAX_DIMENSIONS - 1] =
+			{
+				{1, 0, {1}},
+				{2, 1, {1, 3}},
+				{3, 1, {1, 3, 1}},
+				{3, 2, {1, 1, 1}},
+				{4, 1, {1, 1, 3, 3}},
+				{4, 4, {1, 3, 5, 13}}
+			};
+			DirectionNumbers numbers;
+			// First dimension: van der Corput sequence
+			for(int bit = 0; bit < NUM_BITS; ++bit) numbers[0][bit] = 1u << (NUM_BITS - 1 - bit);
+			for(int dimension = 1; dimension < MAX_DIMENSIONS; ++dimension)
+			{
+				const PrimitivePolynomial& polynomial = polynomials[dimension - 1];
+				const int degree = polynomial.degree;
+				for(int bit = 0; bit < NUM_BITS; ++bit)
+				{
+					if(bit < degree)
+					{
+						numbers[dimension][bit] = polynomial.initialNumbers[bit] << (NUM_BITS - 1 - bit);
+						continue;
+					}
+					std::uint32_t number = numbers[dimension][bit - degree] ^ (numbers[dimension][bit - degree] >> degree);
+					for(int k = 1; k < degree; ++k)
+					{
+						if((polynomial.coefficients >> (degree - 1 - k)) & 1u) number ^= numbers[dimension][bit - k];
+					}
+					numbers[dimension][bit] = number;
+				}
+			}
+			return numbers;
+		}
+		static std::uint32_t reverseBits(std::uint32_t x)
+		{
+			x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+			x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+			x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+			x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+			return (x >> 16) | (x << 16);
+		}
+		// Laine-Karras permutation applied to the bit reversed value: each bit is flipped
+		// depending only on the bits above it, which is exactly Owen's nested scrambling
+		static std::uint32_t nestedUniformScramble(std::uint32_t x, const std::uint32_t& seed)
+		{
+			x  = reverseBits(x);
+			x += seed;
+			x ^= x * 0x6C50B47Cu;
+			x ^= x * 0xB82F1E52u;
+			x ^= x * 0xC7AFE638u;
+			x ^= x * 0x8D22F6E6u;
+			return reverseBits(x);
+		}
+	public:
+		// The scrambling seeds of the dimensions are derived from the seed of the randomisation (splitmix64)
+		SobolSequence(std::uint64_t seed)
+		{
+			for(auto& dimensionSeed: dimensionSeeds)
+			{
+				seed += 0x9E3779B97F4A7C15ull;
+				std::uint64_t mixed = seed;
+				mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+				mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+				dimensionSeed = static_cast<std::uint32_t>(mixed ^ (mixed >> 31));
+			}
+		}
+		// Unscrambled value of the index-th point, as a 32 bit fraction
+		static std::uint32_t rawSample(std::uint32_t index, const int& dimension)
+		{
+			if(dimension < 0 || MAX_DIMENSIONS <= dimension) throw std::out_of_range("Sobol sequence dimension out of range");
+			const auto& numbers = directionNumbers()[dimension];
+			std::uint32_t result = 0;
+			for(int bit = 0; index != 0; ++bit, index >>= 1)
+			{
+				if(index & 1u) result ^= numbers[bit];
+			}
+			return result;
+		}
+		// Scrambled value of the index-th point in [0, 1)
+		double sample(const std::uint32_t& index, const int& dimension) const
+		{
+			return nestedUniformScramble(rawSample(index, dimension), dimensionSeeds[dimension]) * (1.0 / 4294967296.0);
+		}
+		void fillSample(const std::uint32_t& index, double* samples, const int& numDimensions) const
+		{
+			for(int dimension = 0; dimension < numDimensions; ++dimension) samples[dimension] = sample(index, dimension);
+		}
+};
+
+constexpr int SobolSequence::MAX_DIMENSIONS;
+constexpr int SobolSequence::NUM_BITS;
+
+#endif
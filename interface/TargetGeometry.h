@@ -0,0 +1,374 @@
+#ifndef TARGET_GEOMETRY_H
+#define TARGET_GEOMETRY_H
+
+#include <cstdint>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <tuple>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glm/glm.hpp>
+
+#include "PhiloxRandom.h"
+#include "WorkerPlacement.h"
+
+using glm::vec3;
+
+static_assert(sizeof(vec3) == 3 * sizeof(float), "The charge positions are read as packed float triplets.");
+
+// Read-only memory mapping of a whole file, unmapped when destroyed
+class MappedFile
+{
+	private:
+		const char* data = nullptr;
+		std::size_t size = 0;
+	public:
+		MappedFile(const std::string& path)
+		{
+			const int fd = open(path.c_str(), O_RDONLY);
+			if(fd < 0) return;
+			struct stat status;
+			if(fstat(fd, &status) == 0 && 0 < status.st_size)
+			{
+				void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(mapping != MAP_FAILED)
+				{
+					madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+					data = static_cast<const char*>(mapping);
+					size = status.st_size;
+				}
+			}
+			close(fd);
+		}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile() { if(data) munmap(const_cast<char*>(data), size); }
+		bool        isValid() const { return data != nullptr; }
+		const char* getData() const { return data; }
+		std::size_t getSize() const { return size; }
+};
+
+// Fixed point charges of a scattering target, as two contiguous arrays indexed by the charge: the positions and the charges.
+// The arrays are shared by the copies of a geometry and never modified, so the experiments of every thread read the same
+// memory, or a copy of it per NUMA node (getNodeLocal()). A geometry is built by
+//  - the lattice generators: line(), squareSheet(), hexagonalSheet(), cubicCrystal(), centered on the origin with the
+//    lines along x and the sheets in the x-z plane, perpendicular to the beam,
+//  - loadXyz(): text files of "<count>", "<comment>", then "<element> <x> <y> <z> [charge]" lines (H and p are protons),
+//  - loadBinary(): files written by writeBinary(), the arrays are used in place from the memory mapping of the file.
+class TargetGeometry
+{
+	public:
+		static constexpr std::uint32_t binaryFormat = 0x54470001; // "TG", version 1
+	private:
+		// Header of the binary format, followed by the positions (3 floats each) and the charges (1 float each)
+		struct BinaryHeader
+		{
+			std::uint32_t format;
+			std::uint32_t reserved;
+			std::uint64_t numCharges;
+		};
+		std::shared_ptr<const void> storage;  // owns the arrays: vectors or a MappedFile
+		const vec3*                 positions  = nullptr;
+		const float*                charges    = nullptr;
+		int                         numCharges = 0;
+		std::string                 description;
+		struct OwnedArrays
+		{
+			std::vector<vec3>  positions;
+			std::vector<float> charges;
+		};
+		static TargetGeometry fromArrays(std::vector<vec3> positionsArg, std::vector<float> chargesArg, const std::string& descriptionArg)
+		{
+			std::shared_ptr<OwnedArrays> arrays(new OwnedArrays{std::move(positionsArg), std::move(chargesArg)});
+			TargetGeometry geometry;
+			geometry.storage     = arrays;
+			geometry.positions   = arrays -> positions.data();
+			geometry.charges     = arrays -> charges.data();
+			geometry.numCharges  = arrays -> positions.size();
+			geometry.description = descriptionArg;
+			return geometry;
+		}
+		// Next whitespace separated token of the line, false at the end of the line
+		static bool nextToken(const char*& cursor, const char* lineEnd, std::string& token)
+		{
+			while(cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) ++cursor;
+			const char* tokenBegin = cursor;
+			while(cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r') ++cursor;
+			token.assign(tokenBegin, cursor);
+			return !token.empty();
+		}
+		static bool parseFloat(const std::string& token, float& value)
+		{
+			char* end = nullptr;
+			value = std::strtof(token.c_str(), &end);
+			return !token.empty() && *end == '\0';
+		}
+		// A number of charges: 0 to INT_MAX
+		static bool parseCount(const std::string& token, long long& value)
+		{
+			char* end = nullptr;
+			errno = 0;
+			value = std::strtoll(token.c_str(), &end, 10);
+			return !token.empty() && *end == '\0' && errno != ERANGE && 0 <= value && value <= INT_MAX;
+		}
+		// Copy of the arrays made by the calling thread, so that they are in the memory of its NUMA node, shared by the
+		// threads of the node. Kept while the geometry's arrays exist.
+		TargetGeometry nodeReplica(const int& node) const
+		{
+			struct Replica
+			{
+				std::weak_ptr<const void> original;
+				int                       node;
+				TargetGeometry            copy;
+			};
+			static std::mutex           replicasMutex;
+			static std::vector<Replica> replicas;
+			std::unique_lock<std::mutex> lock(replicasMutex);
+			replicas.erase(std::remove_if(replicas.begin(), replicas.end(), [] (const Replica& replica) { return replica.original.expired(); }), replicas.end());
+			for(const auto& replica: replicas)
+			{
+				if(replica.node == node && !replica.original.owner_before(storage) && !storage.owner_before(replica.original)) return replica.copy;
+			}
+			const TargetGeometry copy = fromArrays(std::vector<vec3>(positions, positions + numCharges), std::vector<float>(charges, charges + numCharges), description);
+			replicas.push_back(Replica{storage, node, copy});
+			return copy;
+		}
+		// A site is a vacancy by the block of its index in a Philox stream of the seed, independent of the other sites
+		static bool isVacancy(const int& siteIndex, const double& vacancyFraction, const std::uint64_t& seed)
+		{
+			const PhiloxRandom siteStream(seed, 0x56414341u, 0u); // "VACA"
+			return siteStream.generateBlock(siteIndex)[0] < vacancyFraction * 4294967296.0;
+		}
+	public:
+		TargetGeometry() = default;
+		int          getNumCharges()  const { return numCharges; }
+		const vec3*  getPositions()   const { return positions; }
+		const float* getCharges()     const { return charges; }
+		const std::string& getDescription() const { return description; }
+		bool isEmpty() const { return numCharges == 0; }
+		// The same charges in the memory of the calling worker's NUMA node when the workers span several nodes (see
+		// WorkerPlacement), this geometry otherwise. The arrays of a replica are valid as long as this geometry's.
+		TargetGeometry getNodeLocal() const
+		{
+			const int node = WorkerPlacement::getCurrentNode();
+			if(node < 0 || numCharges == 0) return *this;
+			thread_local std::weak_ptr<const void> cachedOriginal;
+			thread_local TargetGeometry            cachedReplica;
+			const bool cached = !cachedOriginal.expired() && !cachedOriginal.owner_before(storage) && !storage.owner_before(cachedOriginal);
+			if(!cached)
+			{
+				cachedReplica  = nodeReplica(node);
+				cachedOriginal = storage;
+			}
+			return cachedReplica;
+		}
+		// Point charges of the given charge at the given positions
+		static TargetGeometry fromPositions(const std::vector<vec3>& positionsArg, const float& charge, const std::string& descriptionArg)
+		{
+			return fromArrays(positionsArg, std::vector<float>(positionsArg.size(), charge), descriptionArg);
+		}
+		// numCharges charges on the x axis, the first one at (-0.5 * numCharges + 0.5) * spacing
+		static TargetGeometry line(const int& numChargesArg, const float& spacing, const float& charge)
+		{
+			std::vector<vec3> linePositions;
+			linePositions.reserve(numChargesArg);
+			for(int index = 0; index < numChargesArg; ++index) linePositions.emplace_back((-0.5f * numChargesArg + index + 0.5f) * spacing, 0.0f, 0.0f);
+			return fromPositions(linePositions, charge, "line of " + std::to_string(numChargesArg) + " charges, spacing " + std::to_string(spacing));
+		}
+		// numRows lines of numColumns charges along x, stacked along z
+		static TargetGeometry squareSheet(const int& numColumns, const int& numRows, const float& spacing, const float& charge)
+		{
+			std::vector<vec3> sheetPositions;
+			sheetPositions.reserve(static_cast<std::size_t>(numColumns) * numRows);
+			for(int row = 0; row < numRows; ++row)
+			{
+				for(int column = 0; column < numColumns; ++column)
+				{
+					sheetPositions.emplace_back((-0.5f * numColumns + column + 0.5f) * spacing, 0.0f, (-0.5f * numRows + row + 0.5f) * spacing);
+				}
+			}
+			return fromPositions(sheetPositions, charge, "square sheet of " + std::to_string(numColumns) + " x " + std::to_string(numRows) + " charges, spacing " + std::to_string(spacing));
+		}
+		// Triangular lattice of nearest neighbour distance spacing: rows sqrt(3) / 2 * spacing apart along z, shifted by
+		// -spacing / 4 and +spacing / 4 along x in turn, so that the sheet stays centered
+		static TargetGeometry hexagonalSheet(const int& numColumns, const int& numRows, const float& spacing, const float& charge)
+		{
+			const float rowDistance = 0.5f * std::sqrt(3.0f) * spacing;
+			std::vector<vec3> sheetPositions;
+			sheetPositions.reserve(static_cast<std::size_t>(numColumns) * numRows);
+			for(int row = 0; row < numRows; ++row)
+			{
+				const float shift = (row % 2 == 0 ? -0.25f : 0.25f) * spacing;
+				for(int column = 0; column < numColumns; ++column)
+				{
+					sheetPositions.emplace_back((-0.5f * numColumns + column + 0.5f) * spacing + shift, 0.0f, (-0.5f * numRows + row + 0.5f) * rowDistance);
+				}
+			}
+			return fromPositions(sheetPositions, charge, "hexagonal sheet of " + std::to_string(numColumns) + " x " + std::to_string(numRows) + " charges, spacing " + std::to_string(spacing));
+		}
+		// Simple cubic crystal of numX x numY x numZ sites, a vacancyFraction of them left empty (drawn from the seed)
+		static TargetGeometry cubicCrystal(const int& numX, const int& numY, const int& numZ, const float& spacing, const float& charge, const double& vacancyFraction, const std::uint64_t& seed)
+		{
+			std::vector<vec3> crystalPositions;
+			crystalPositions.reserve(static_cast<std::size_t>(numX) * numY * numZ);
+			int siteIndex = 0;
+			for(int zIndex = 0; zIndex < numZ; ++zIndex)
+			{
+				for(int yIndex = 0; yIndex < numY; ++yIndex)
+				{
+					for(int xIndex = 0; xIndex < numX; ++xIndex, ++siteIndex)
+					{
+						if(0.0 < vacancyFraction && isVacancy(siteIndex, vacancyFraction, seed)) continue;
+						crystalPositions.emplace_back((-0.5f * numX + xIndex + 0.5f) * spacing, (-0.5f * numY + yIndex + 0.5f) * spacing, (-0.5f * numZ + zIndex + 0.5f) * spacing);
+					}
+				}
+			}
+			return fromPositions(crystalPositions, charge, "cubic crystal of " + std::to_string(numX) + " x " + std::to_string(numY) + " x " + std::to_string(numZ) + " sites, "
+				+ std::to_string(crystalPositions.size()) + " charges, spacing " + std::to_string(spacing));
+		}
+		// Lengths are multiplied by lengthUnit (e.g. bohrs per angstrom). Returns an empty geometry and the reason in error
+		// if the file can not be read.
+		static TargetGeometry loadXyz(const std::string& path, const float& lengthUnit, std::string& error)
+		{
+			const MappedFile file(path);
+			if(!file.isValid())
+			{
+				error = "can not read " + path;
+				return TargetGeometry();
+			}
+			const char* cursor = file.getData();
+			const char* end    = file.getData() + file.getSize();
+			std::vector<vec3>  xyzPositions;
+			std::vector<float> xyzCharges;
+			std::string token;
+			long long declaredCount = -1;
+			for(int lineNumber = 1; cursor < end; ++lineNumber)
+			{
+				const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+				if(!lineEnd) lineEnd = end;
+				if(lineNumber == 1)
+				{
+					if(!nextToken(cursor, lineEnd, token) || !parseCount(token, declaredCount))
+					{
+						error = path + ":1: expected the number of charges (0 to " + std::to_string(INT_MAX) + ")";
+						return TargetGeometry();
+					}
+					// A charge takes a line of at least 8 bytes ("H 0 0 0\n"): a larger count is reported below
+					const long long maxCount = file.getSize() / 8;
+					xyzPositions.reserve(std::min(declaredCount, maxCount));
+					xyzCharges  .reserve(std::min(declaredCount, maxCount));
+				}
+				else if(2 < lineNumber && nextToken(cursor, lineEnd, token))
+				{
+					const std::string element = token;
+					float coordinates[3];
+					float charge = 0.0f;
+					bool valid = true;
+					for(auto& coordinate: coordinates) valid = valid && nextToken(cursor, lineEnd, token) && parseFloat(token, coordinate);
+					if(nextToken(cursor, lineEnd, token)) valid = valid && parseFloat(token, charge);
+					else if(element == "H" || element == "p") charge = 1.0f;
+					else valid = false;
+					if(!valid)
+					{
+						error = path + ":" + std::to_string(lineNumber) + ": expected <element> <x> <y> <z> [charge], the charge is needed for elements other than H and p";
+						return TargetGeometry();
+					}
+					xyzPositions.emplace_back(coordinates[0] * lengthUnit, coordinates[1] * lengthUnit, coordinates[2] * lengthUnit);
+					xyzCharges.push_back(charge);
+				}
+				cursor = lineEnd + 1;
+			}
+			if(static_cast<long long>(xyzPositions.size()) != declaredCount)
+			{
+				error = path + ": " + std::to_string(xyzPositions.size()) + " charges instead of the declared " + std::to_string(declaredCount);
+				return TargetGeometry();
+			}
+			return fromArrays(std::move(xyzPositions), std::move(xyzCharges), path);
+		}
+		// The arrays are not copied: the geometry keeps the file mapped
+		static TargetGeometry loadBinary(const std::string& path, std::string& error)
+		{
+			std::shared_ptr<MappedFile> file(new MappedFile(path));
+			BinaryHeader header;
+			if(!file -> isValid() || file -> getSize() < sizeof(header))
+			{
+				error = "can not read " + path;
+				return TargetGeometry();
+			}
+			std::memcpy(&header, file -> getData(), sizeof(header));
+			// Divided rather than multiplied: a corrupt count must not wrap around to the size of the file
+			const std::uint64_t bodySize = file -> getSize() - sizeof(header);
+			const std::uint64_t chargeSize = sizeof(vec3) + sizeof(float);
+			if(header.format != binaryFormat || INT_MAX < header.numCharges || bodySize % chargeSize != 0 || bodySize / chargeSize != header.numCharges)
+			{
+				error = path + " is not a complete target geometry file";
+				return TargetGeometry();
+			}
+			TargetGeometry geometry;
+			geometry.storage     = file;
+			geometry.positions   = reinterpret_cast<const vec3*> (file -> getData() + sizeof(header));
+			geometry.charges     = reinterpret_cast<const float*>(file -> getData() + sizeof(header) + header.numCharges * sizeof(vec3));
+			geometry.numCharges  = header.numCharges;
+			geometry.description = path;
+			return geometry;
+		}
+		// Chooses the format by the extension: ".xyz" files are text, the others binary
+		static TargetGeometry load(const std::string& path, const float& xyzLengthUnit, std::string& error)
+		{
+			const bool xyz = 4 <= path.size() && path.compare(path.size() - 4, 4, ".xyz") == 0;
+			return xyz ? loadXyz(path, xyzLengthUnit, error) : loadBinary(path, error);
+		}
+		bool writeBinary(const std::string& path) const
+		{
+			const BinaryHeader header{binaryFormat, 0, static_cast<std::uint64_t>(numCharges)};
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			stream.write(reinterpret_cast<const char*>(positions), numCharges * sizeof(vec3));
+			stream.write(reinterpret_cast<const char*>(charges),   numCharges * sizeof(float));
+			return static_cast<bool>(stream);
+		}
+		// Bounding box of the charges, empty geometries give the origin
+		void getBounds(vec3& boundsMin, vec3& boundsMax) const
+		{
+			boundsMin = boundsMax = numCharges ? positions[0] : vec3(0.0f);
+			for(int index = 1; index < numCharges; ++index)
+			{
+				boundsMin = glm::min(boundsMin, positions[index]);
+				boundsMax = glm::max(boundsMax, positions[index]);
+			}
+		}
+		// True if the reflection of the coordinate axis (0: x, 1: y, 2: z) maps the charges onto charges of the same value,
+		// positions compared on a grid of tolerance
+		bool isMirrorSymmetric(const int& axis, const float& tolerance) const
+		{
+			using Site = std::tuple<long long, long long, long long, float>;
+			std::vector<Site> sites, mirroredSites;
+			sites        .reserve(numCharges);
+			mirroredSites.reserve(numCharges);
+			for(int index = 0; index < numCharges; ++index)
+			{
+				vec3 position = positions[index];
+				sites.emplace_back(std::llround(position.x / tolerance), std::llround(position.y / tolerance), std::llround(position.z / tolerance), charges[index]);
+				position[axis] = -position[axis];
+				mirroredSites.emplace_back(std::llround(position.x / tolerance), std::llround(position.y / tolerance), std::llround(position.z / tolerance), charges[index]);
+			}
+			std::sort(sites.begin(), sites.end());
+			std::sort(mirroredSites.begin(), mirroredSites.end());
+			return sites == mirroredSites;
+		}
+};
+
+constexpr std::uint32_t TargetGeometry::binaryFormat;
+
+#endif
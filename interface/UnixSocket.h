@@ -0,0 +1,166 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Stream socket of the local (Unix) domain, carrying text lines. Used by the job server of the experiment
+// matrix and its client: a connection is closed when its socket is destroyed, a listening socket also
+// removes its socket file. The socket file is only accessible to its owner.
+class UnixSocket
+{
+	private:
+		int         fd = -1;
+		std::string boundPath;  // socket file of a listening socket
+		std::string readBuffer; // received bytes after the last line read
+		static bool fillAddress(const std::string& path, sockaddr_un& address)
+		{
+			std::memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			if(sizeof(address.sun_path) <= path.size()) return false;
+			std::strcpy(address.sun_path, path.c_str());
+			return true;
+		}
+		void close()
+		{
+			if(0 <= fd) ::close(fd);
+			if(!boundPath.empty()) unlink(boundPath.c_str());
+			fd = -1;
+			boundPath.clear();
+		}
+	public:
+		explicit UnixSocket(const int& fdArg = -1): fd(fdArg) {}
+		UnixSocket(const UnixSocket&) = delete;
+		UnixSocket& operator=(const UnixSocket&) = delete;
+		UnixSocket(UnixSocket&& other): fd(other.fd), boundPath(std::move(other.boundPath)), readBuffer(std::move(other.readBuffer))
+		{
+			other.fd = -1;
+			other.boundPath.clear();
+		}
+		UnixSocket& operator=(UnixSocket&& other)
+		{
+			if(this == &other) return *this;
+			close();
+			fd         = other.fd;
+			boundPath  = std::move(other.boundPath);
+			readBuffer = std::move(other.readBuffer);
+			other.fd = -1;
+			other.boundPath.clear();
+			return *this;
+		}
+		~UnixSocket() { close(); }
+		bool isValid() const { return 0 <= fd; }
+		// The socket named name in the user's runtime directory ($XDG_RUNTIME_DIR), in /tmp with the user id appended
+		// without one
+		static std::string userRuntimePath(const std::string& name)
+		{
+			const char* runtimeDirectory = std::getenv("XDG_RUNTIME_DIR");
+			if(runtimeDirectory && runtimeDirectory[0] == '/') return std::string(runtimeDirectory) + "/" + name;
+			return "/tmp/" + name + "." + std::to_string(getuid());
+		}
+		// Invalid if there is no server at path
+		static UnixSocket connect(const std::string& path)
+		{
+			sockaddr_un address;
+			UnixSocket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+			if(!socket.isValid() || !fillAddress(path, address) || ::connect(socket.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return UnixSocket();
+			return socket;
+		}
+		// A socket file of the user left by a server that was killed is replaced, any other file at path is left alone.
+		// The socket file gets the permissions 0600. Invalid if path can not be bound.
+		static UnixSocket listen(const std::string& path)
+		{
+			sockaddr_un address;
+			UnixSocket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+			if(!socket.isValid() || !fillAddress(path, address)) return UnixSocket();
+			if(connect(path).isValid()) return UnixSocket(); // another server is running
+			struct stat status;
+			if(lstat(path.c_str(), &status) == 0)
+			{
+				if(!S_ISSOCK(status.st_mode) || status.st_uid != getuid()) return UnixSocket();
+				unlink(path.c_str());
+			}
+			if(bind(socket.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return UnixSocket();
+			socket.boundPath = path;
+			// Before listening: no client can connect in between
+			if(chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(socket.fd, SOMAXCONN) != 0) return UnixSocket();
+			return socket;
+		}
+		// writeLine() then fails instead of waiting for a peer that does not read its end
+		bool setNonBlocking()
+		{
+			const int flags = fcntl(fd, F_GETFL);
+			return 0 <= flags && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+		}
+		// Reads up to the next newline, which is removed. Returns false at the end of the stream and if no bytes arrived
+		// within timeoutSeconds (negative: no timeout).
+		bool readLine(std::string& line, const double& timeoutSeconds = -1.0)
+		{
+			while(!takeLine(line))
+			{
+				pollfd pollRequest{fd, POLLIN, 0};
+				if(poll(&pollRequest, 1, timeoutSeconds < 0.0 ? -1 : static_cast<int>(timeoutSeconds * 1000)) <= 0 || !receive()) return false;
+			}
+			return true;
+		}
+		// Waits until one of the sockets can be read without blocking (a listening socket: a client is waiting to be accepted,
+		// a connection: bytes or the end of the stream arrived) or timeoutSeconds passed. Returns the readable flags of the
+		// sockets, used with acceptWaiting and receive by a single thread serving several connections.
+		static std::vector<char> waitReadable(const std::vector<const UnixSocket*>& sockets, const double& timeoutSeconds)
+		{
+			std::vector<pollfd> pollRequests;
+			for(const UnixSocket* socket: sockets) pollRequests.push_back(pollfd{socket -> fd, POLLIN, 0});
+			std::vector<char> readable(sockets.size(), 0);
+			if(poll(pollRequests.data(), pollRequests.size(), static_cast<int>(timeoutSeconds * 1000)) <= 0) return readable;
+			for(unsigned int index = 0; index < sockets.size(); ++index) readable[index] = pollRequests[index].revents != 0;
+			return readable;
+		}
+		// Accepts the client a listening socket was found readable for
+		UnixSocket acceptWaiting() { return UnixSocket(::accept(fd, nullptr, nullptr)); }
+		// Reads the bytes a connection was found readable for with a single read, which does not block. Returns false at the
+		// end of the stream.
+		bool receive()
+		{
+			char buffer[4096];
+			const ssize_t numRead = read(fd, buffer, sizeof(buffer));
+			if(numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true; // non-blocking, nothing arrived after all
+			if(numRead <= 0) return false;
+			readBuffer.append(buffer, numRead);
+			return true;
+		}
+		// Takes the next line of the received bytes without reading, false if no complete line was received
+		bool takeLine(std::string& line)
+		{
+			const std::size_t newline = readBuffer.find('\n');
+			if(newline == std::string::npos) return false;
+			line = readBuffer.substr(0, newline);
+			readBuffer.erase(0, newline + 1);
+			return true;
+		}
+		// Received bytes not taken as a line yet
+		std::size_t getNumBufferedBytes() const { return readBuffer.size(); }
+		// Appends the newline. Returns false if the peer closed its end (no SIGPIPE is raised), on a non-blocking socket
+		// also if the line does not fit into the socket buffer: the rest of it is not sent.
+		bool writeLine(const std::string& line)
+		{
+			const std::string message = line + "\n";
+			for(std::size_t numWritten = 0; numWritten < message.size(); )
+			{
+				const ssize_t numSent = send(fd, message.data() + numWritten, message.size() - numWritten, MSG_NOSIGNAL);
+				if(numSent <= 0) return false;
+				numWritten += numSent;
+			}
+			return true;
+		}
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef WORK_STEALING_SCHEDULER_H
+#define WORK_STEALING_SCHEDULER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+#include "WorkerPlacement.h"
+
+// Online mean and variance of the cost of a single work unit (Welford's method)
+class CostStatistics
+{
+	private:
+		mutable std::mutex statisticsMutex;
+		long long          numSamples = 0;
+		double             mean       = 0.0;
+		double             sumOfSquaredDifferences = 0.0;
+	public:
+		void add(const double& cost)
+		{
+			std::unique_lock<std::mutex> lock(statisticsMutex);
+			++numSamples;
+			double difference = cost - mean;
+			mean += difference / numSamples;
+			sumOfSquaredDifferences += difference * (cost - mean);
+		}
+		long long getNumSamples() const
+		{
+			std::unique_lock<std::mutex> lock(statisticsMutex);
+			return numSamples;
+		}
+		// Falls back to the prior until there are enough samples
+		double getMean(const double& prior) const
+		{
+			std::unique_lock<std::mutex> lock(statisticsMutex);
+			return numSamples < 2 ? prior : mean;
+		}
+		double getStandardDeviation() const
+		{
+			std::unique_lock<std::mutex> lock(statisticsMutex);
+			return numSamples < 2 ? 0.0 : std::sqrt(sumOfSquaredDifferences / (numSamples - 1));
+		}
+};
+
+// Range of work units [begin, end) belonging to a group of units of similar cost
+struct WorkRange
+{
+	int group;
+	int begin;
+	int end;
+	int size() const { return end - begin; }
+};
+
+// Processes work units of several groups on a set of threads.
+// The ranges are ordered by decreasing expected cost and dealt out to the per-thread deques.
+// A thread takes a chunk from the front of its own deque and puts the rest of the range back;
+// the chunk size is chosen so that the remaining expected work is split into about
+// CHUNKS_PER_THREAD pieces per thread (guided scheduling). Idle threads steal half of the
+// last range of another thread. A thread that finds nothing to steal sleeps on runStarted
+// until another thread stole a range (new work to steal) or the run is finished.
+// The threads are started by the constructor and kept between the runs, so everything a unit keeps
+// in thread_local storage (e.g. the particles of the experiments) is built once per thread.
+// Pinned threads (see WorkerPlacement) stay on their CPU, that storage then stays in the memory of their NUMA node.
+class WorkStealingScheduler
+{
+	public:
+		// Expected cost of a single unit of the given group (e.g. number of integration steps)
+		using UnitCostEstimator = std::function<double(const int& group)>;
+		using UnitProcessor     = std::function<void(const int& group, const int& unit)>;
+		using ProgressCallback  = std::function<void(const long long& numUnitsDone, const long long& numUnitsTotal)>;
+		static constexpr int CHUNKS_PER_THREAD = 4;
+	private:
+		struct WorkerQueue
+		{
+			std::mutex            queueMutex;
+			std::deque<WorkRange> ranges;
+		};
+		unsigned int                              numThreads;
+		WorkerPlacement                           placement;
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::atomic<long long>                    numUnitsLeft;
+		std::atomic<long long>                    numUnitsDone;
+		std::vector<std::atomic<long long>>*      groupUnitsLeft = nullptr;
+		UnitCostEstimator                         expectedUnitCost;
+		UnitProcessor                             processUnit;
+		std::mutex                                runMutex;
+		std::condition_variable                   runStarted;
+		std::condition_variable                   runFinished;
+		unsigned long long                        runNumber         = 0;
+		unsigned long long                        numStealsDone     = 0;
+		unsigned int                              numThreadsBusy    = 0;
+		unsigned int                              numThreadsStarted = 0;
+		unsigned int                              numPinFailures    = 0;
+		bool                                      shutdown          = false;
+		std::vector<std::thread>                  workers;
+		double remainingExpectedCost() const
+		{
+			double cost = 0.0;
+			for(int group = 0; group < static_cast<int>(groupUnitsLeft -> size()); ++group)
+			{
+				cost += (*groupUnitsLeft)[group].load() * expectedUnitCost(group);
+			}
+			return cost;
+		}
+		int chunkSize(const WorkRange& range) const
+		{
+			double unitCost    = std::max(expectedUnitCost(range.group), 1e-12);
+			double targetCost  = remainingExpectedCost() / (numThreads * CHUNKS_PER_THREAD);
+			int    targetUnits = static_cast<int>(targetCost / unitCost);
+			return std::max(1, std::min(range.size(), targetUnits));
+		}
+		bool popOwn(const unsigned int& threadIndex, WorkRange& chunk)
+		{
+			WorkerQueue& queue = *queues[threadIndex];
+			std::unique_lock<std::mutex> lock(queue.queueMutex);
+			if(queue.ranges.empty()) return false;
+			WorkRange& range = queue.ranges.front();
+			int size = chunkSize(range);
+			chunk = WorkRange{range.group, range.begin, range.begin + size};
+			range.begin += size;
+			if(range.size() == 0) queue.ranges.pop_front();
+			return true;
+		}
+		bool steal(const unsigned int& threadIndex)
+		{
+			for(unsigned int offset = 1; offset < numThreads; ++offset)
+			{
+				WorkerQueue& victim = *queues[(threadIndex + offset) % numThreads];
+				WorkRange stolen;
+				{
+					std::unique_lock<std::mutex> lock(victim.queueMutex);
+					if(victim.ranges.empty()) continue;
+					WorkRange& range = victim.ranges.back();
+					if(range.size() == 1)
+					{
+						stolen = range;
+						victim.ranges.pop_back();
+					}
+					else
+					{
+						int middle = range.begin + range.size() / 2;
+						stolen = WorkRange{range.group, middle, range.end};
+						range.end = middle;
+					}
+				}
+				{
+					WorkerQueue& own = *queues[threadIndex];
+					std::unique_lock<std::mutex> lock(own.queueMutex);
+					own.ranges.push_back(stolen);
+				}
+				// The rest of the stolen range can be stolen by the sleeping threads
+				std::unique_lock<std::mutex> lock(runMutex);
+				++numStealsDone;
+				runStarted.notify_all();
+				return true;
+			}
+			return false;
+		}
+		void workerLoop(const unsigned int& threadIndex)
+		{
+			while(0 < numUnitsLeft)
+			{
+				WorkRange chunk;
+				if(!popOwn(threadIndex, chunk))
+				{
+					// Ranges only appear in a queue by stealing: if nothing was stolen since the failed
+					// attempt, every unit left is in progress on another thread
+					unsigned long long seenSteals;
+					{
+						std::unique_lock<std::mutex> lock(runMutex);
+						seenSteals = numStealsDone;
+					}
+					if(steal(threadIndex)) continue;
+					std::unique_lock<std::mutex> lock(runMutex);
+					runStarted.wait(lock, [this, &seenSteals] { return numUnitsLeft == 0 || numStealsDone != seenSteals; });
+					continue;
+				}
+				for(int unit = chunk.begin; unit < chunk.end; ++unit)
+				{
+					processUnit(chunk.group, unit);
+					--(*groupUnitsLeft)[chunk.group];
+					++numUnitsDone;
+					if(--numUnitsLeft == 0)
+					{
+						std::unique_lock<std::mutex> lock(runMutex);
+						runStarted.notify_all();
+					}
+				}
+			}
+		}
+		// Waits for the next run, processes its units and reports back until the scheduler is destroyed
+		void workerMain(const unsigned int& threadIndex)
+		{
+			const bool pinned = placement.enterWorker(threadIndex);
+			unsigned long long lastRunNumber = 0;
+			std::unique_lock<std::mutex> lock(runMutex);
+			numPinFailures += !pinned;
+			if(++numThreadsStarted == numThreads) runFinished.notify_all();
+			while(1)
+			{
+				runStarted.wait(lock, [this, &lastRunNumber] { return shutdown || runNumber != lastRunNumber; });
+				if(shutdown) return;
+				lastRunNumber = runNumber;
+				lock.unlock();
+				workerLoop(threadIndex);
+				lock.lock();
+				if(--numThreadsBusy == 0) runFinished.notify_all();
+			}
+		}
+	public:
+		// Zero threads means one thread per hardware thread
+		WorkStealingScheduler(unsigned int numThreadsArg = 0, const bool& pinThreads = false):
+			numThreads(numThreadsArg ? numThreadsArg : std::max(1u, std::thread::hardware_concurrency())), placement(numThreads, pinThreads)
+		{
+			for(unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+			{
+				queues.emplace_back(new WorkerQueue());
+			}
+			for(unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+			{
+				workers.emplace_back(&WorkStealingScheduler::workerMain, this, threadIndex);
+			}
+			// The threads are pinned before the first run
+			std::unique_lock<std::mutex> lock(runMutex);
+			runFinished.wait(lock, [this] { return numThreadsStarted == numThreads; });
+		}
+		WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+		WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+		~WorkStealingScheduler()
+		{
+			{
+				std::unique_lock<std::mutex> lock(runMutex);
+				shutdown = true;
+			}
+			runStarted.notify_all();
+			for(auto& worker: workers) worker.join();
+		}
+		unsigned int size() const { return numThreads; }
+		const WorkerPlacement& getPlacement() const { return placement; }
+		// Threads that could not be pinned to their CPU
+		unsigned int getNumPinFailures() const { return numPinFailures; }
+		// Blocks until every unit is processed, the calling thread reports the progress.
+		// Runs of several threads are not supported.
+		void run(std::vector<WorkRange> ranges, const UnitCostEstimator& expectedUnitCostArg, const UnitProcessor& processUnitArg, const ProgressCallback& progressCallback)
+		{
+			expectedUnitCost = expectedUnitCostArg;
+			processUnit      = processUnitArg;
+			int numGroups = 0;
+			long long numUnitsTotal = 0;
+			for(const auto& range: ranges)
+			{
+				numGroups      = std::max(numGroups, range.group + 1);
+				numUnitsTotal += range.size();
+			}
+			std::vector<std::atomic<long long>> unitsLeftPerGroup(numGroups);
+			for(auto& unitsLeft: unitsLeftPerGroup) unitsLeft = 0;
+			for(const auto& range: ranges) unitsLeftPerGroup[range.group] += range.size();
+			groupUnitsLeft = &unitsLeftPerGroup;
+			numUnitsLeft   = numUnitsTotal;
+			numUnitsDone   = 0;
+			// Longest expected first
+			std::stable_sort(ranges.begin(), ranges.end(), [this] (const WorkRange& lhs, const WorkRange& rhs)
+			{
+				return lhs.size() * expectedUnitCost(lhs.group) > rhs.size() * expectedUnitCost(rhs.group);
+			});
+			for(auto& queue: queues) queue -> ranges.clear();
+			for(unsigned int rangeIndex = 0; rangeIndex < ranges.size(); ++rangeIndex)
+			{
+				queues[rangeIndex % numThreads] -> ranges.push_back(ranges[rangeIndex]);
+			}
+			std::unique_lock<std::mutex> lock(runMutex);
+			numThreadsBusy = numThreads;
+			++runNumber;
+			runStarted.notify_all();
+			while(!runFinished.wait_for(lock, std::chrono::milliseconds(100), [this] { return numThreadsBusy == 0; }))
+			{
+				lock.unlock();
+				progressCallback(numUnitsDone, numUnitsTotal);
+				lock.lock();
+			}
+			lock.unlock();
+			progressCallback(numUnitsDone, numUnitsTotal);
+			groupUnitsLeft = nullptr;
+		}
+};
+
+constexpr int WorkStealingScheduler::CHUNKS_PER_THREAD;
+
+#endif
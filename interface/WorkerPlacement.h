@@ -0,0 +1,139 @@
+#ifndef WORKER_PLACEMENT_H
+#define WORKER_PLACEMENT_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+
+// NUMA node with the CPUs of it the process may run on
+struct NumaNode
+{
+	int              id;
+	std::vector<int> cpus;
+};
+
+// CPU and NUMA node of every worker thread of a WorkStealingScheduler. The workers are dealt out to the nodes in turn,
+// each taking the next CPU of its node, so that a run of fewer workers than CPUs still uses every node (memory
+// bandwidth, caches). The nodes are read from Linux sysfs; without it (or without NUMA) the allowed CPUs form a single node.
+// Data first touched by a pinned worker is allocated in the memory of its node by the kernel; node-local copies of
+// shared read-only data are looked up by getCurrentNode().
+class WorkerPlacement
+{
+	private:
+		std::vector<NumaNode> nodes;
+		std::vector<int>      workerCpus;  // -1: not pinned
+		std::vector<int>      workerNodes; // indices of nodes
+		// Node of the calling thread, a function-local static so that the header can be included by several translation units
+		static int& currentNode()
+		{
+			static thread_local int node = -1;
+			return node;
+		}
+		// "0-3,8,10-11" -> 0 1 2 3 8 10 11
+		static std::vector<int> parseCpuList(const std::string& cpuList)
+		{
+			std::vector<int> cpus;
+			std::istringstream stream(cpuList);
+			std::string range;
+			while(std::getline(stream, range, ','))
+			{
+				int first = 0, last = 0;
+				const int numRead = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+				if(numRead < 1) continue;
+				if(numRead == 1) last = first;
+				for(int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+			}
+			return cpus;
+		}
+		static std::vector<NumaNode> detectNodes()
+		{
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			const bool affinityKnown = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+			auto isAllowed = [&] (const int& cpu) { return !affinityKnown || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+			std::vector<NumaNode> detected;
+			if(DIR* directory = opendir("/sys/devices/system/node"))
+			{
+				while(dirent* entry = readdir(directory))
+				{
+					int id = 0;
+					if(std::sscanf(entry -> d_name, "node%d", &id) != 1) continue;
+					std::ifstream cpuListFile(std::string("/sys/devices/system/node/") + entry -> d_name + "/cpulist");
+					std::string cpuList;
+					std::getline(cpuListFile, cpuList);
+					NumaNode node{id, {}};
+					for(const int& cpu: parseCpuList(cpuList)) if(isAllowed(cpu)) node.cpus.push_back(cpu);
+					if(!node.cpus.empty()) detected.push_back(node);
+				}
+				closedir(directory);
+			}
+			std::sort(detected.begin(), detected.end(), [] (const NumaNode& lhs, const NumaNode& rhs) { return lhs.id < rhs.id; });
+			if(detected.empty() && affinityKnown)
+			{
+				NumaNode node{0, {}};
+				for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) if(CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+				detected.push_back(node);
+			}
+			return detected;
+		}
+	public:
+		// Without pin the workers are left to the operating system and have no node
+		WorkerPlacement(const unsigned int& numWorkers, const bool& pin)
+		{
+			if(pin) nodes = detectNodes();
+			std::vector<unsigned int> numTaken(nodes.size(), 0);
+			for(unsigned int worker = 0; worker < numWorkers; ++worker)
+			{
+				if(nodes.empty())
+				{
+					workerCpus .push_back(-1);
+					workerNodes.push_back(-1);
+					continue;
+				}
+				// More workers than CPUs share the CPUs in turn
+				const int node = worker % nodes.size();
+				workerCpus .push_back(nodes[node].cpus[numTaken[node]++ % nodes[node].cpus.size()]);
+				workerNodes.push_back(node);
+			}
+		}
+		int getNumNodes()                              const { return std::max<int>(1, nodes.size()); }
+		int getWorkerCpu (const unsigned int& worker) const { return workerCpus [worker]; }
+		int getWorkerNode(const unsigned int& worker) const { return workerNodes[worker]; }
+		// Called by the worker thread itself. Returns false if the thread could not be pinned to its CPU.
+		bool enterWorker(const unsigned int& worker) const
+		{
+			if(workerCpus[worker] < 0) return true;
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(workerCpus[worker], &cpuSet);
+			if(pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) return false;
+			if(1 < nodes.size()) currentNode() = workerNodes[worker];
+			return true;
+		}
+		// Node index of the calling worker thread if the workers span several nodes, -1 otherwise (and for other threads)
+		static int getCurrentNode() { return currentNode(); }
+		// One line per node: its workers and their CPUs
+		std::string describe() const
+		{
+			if(nodes.empty()) return "Worker threads not pinned.\n";
+			std::ostringstream report;
+			for(unsigned int node = 0; node < nodes.size(); ++node)
+			{
+				report << "NUMA node " << nodes[node].id << " (" << nodes[node].cpus.size() << " CPUs): workers";
+				for(unsigned int worker = 0; worker < workerNodes.size(); ++worker)
+				{
+					if(workerNodes[worker] == static_cast<int>(node)) report << " " << worker << "->cpu" << workerCpus[worker];
+				}
+				report << "\n";
+			}
+			return report.str();
+		}
+};
+
+#endif
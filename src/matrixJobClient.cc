@@ -0,0 +1,115 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <iomanip>
+#include <vector>
+
+#include "../interface/UnixSocket.h"
+
+// Client of the job server of the experiment matrix (bin/startProtonsInLineExperimentMatrix --serve [socket path]).
+// The progress goes to the standard error, the results to the standard output as a table of the non-empty
+// histogram bins: x (bin center), content, error, with the summary in comment lines.
+
+const char* SOCKET_NAME = "protonsInLineExperimentMatrix.socket"; // JOB_SERVER_SOCKET_NAME of the server
+
+void printUsage(const char* programName)
+{
+	std::cerr << "Usage: " << programName << " [--socket <path>] run <number of protons> <proton-proton distance (bohr)> <kinetic energy (eV)>\n";
+	std::cerr << "       " << programName << " [--socket <path>] status" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	std::string socketPath = UnixSocket::userRuntimePath(SOCKET_NAME);
+	if(2 <= arguments.size() && arguments[0] == "--socket")
+	{
+		socketPath = arguments[1];
+		arguments.erase(arguments.begin(), arguments.begin() + 2);
+	}
+	const bool runRequest    = arguments.size() == 4 && arguments[0] == "run";
+	const bool statusRequest = arguments.size() == 1 && arguments[0] == "status";
+	if(!runRequest && !statusRequest)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+	UnixSocket connection = UnixSocket::connect(socketPath);
+	if(!connection.isValid())
+	{
+		std::cerr << "Error: no job server at " << socketPath << "." << std::endl;
+		return 1;
+	}
+	std::string request = arguments[0];
+	for(unsigned int index = 1; index < arguments.size(); ++index) request += " " + arguments[index];
+	if(!connection.writeLine(request))
+	{
+		std::cerr << "Error: the request could not be sent." << std::endl;
+		return 1;
+	}
+	int    numBins  = 0;
+	double minRange = 0.0;
+	double maxRange = 0.0;
+	std::string line;
+	while(connection.readLine(line))
+	{
+		std::istringstream lineStream(line);
+		std::string type;
+		lineStream >> type;
+		if(type == "error")
+		{
+			std::cerr << "Error:" << line.substr(type.size()) << std::endl;
+			return 1;
+		}
+		if(type == "status")
+		{
+			int numQueued, numRunning, numThreads;
+			lineStream >> numQueued >> numRunning >> numThreads;
+			std::cout << numQueued << " job(s) queued, " << numRunning << " running on " << numThreads << " worker thread(s)." << std::endl;
+			return 0;
+		}
+		if(type == "queued")
+		{
+			std::cerr << "Job" << line.substr(type.size()) << " queued." << std::endl;
+		}
+		if(type == "progress")
+		{
+			int id, numDone, numTotal;
+			lineStream >> id >> numDone >> numTotal;
+			std::cerr << "\rJob " << id << ": " << numDone << " of " << numTotal << " experiments done" << std::flush;
+		}
+		if(type == "result")
+		{
+			int id, numAbsorbed, numExperiments, fromCache;
+			double updatesPerExperiment;
+			std::string relativePrecision; // inf if no bin holds enough hits to measure it
+			lineStream >> id >> updatesPerExperiment >> numAbsorbed >> relativePrecision >> numExperiments >> fromCache;
+			std::cerr << "\n";
+			std::cout << "# job " << id << ": " << numExperiments << " experiments" << (fromCache ? " (from the result cache)" : "") << "\n";
+			std::cout << "# " << updatesPerExperiment << " updates per experiment, " << numAbsorbed << " experiment fails because of electron absorbtion\n";
+			std::cout << "# relative precision " << relativePrecision << "\n";
+			std::cout << "# x (bohr), content, error\n";
+		}
+		if(type == "histogram")
+		{
+			lineStream >> numBins >> minRange >> maxRange;
+		}
+		if(type == "bin")
+		{
+			int bin;
+			double content, error;
+			lineStream >> bin >> content >> error;
+			// Bins 0 and numBins + 1 are the under- and overflow
+			const double x = minRange + (bin - 0.5) * (maxRange - minRange) / numBins;
+			std::cout << std::setprecision(9) << x << " " << content << " " << error << "\n";
+		}
+		if(type == "done")
+		{
+			std::cout << std::flush;
+			return 0;
+		}
+	}
+	std::cerr << "\nError: the job server closed the connection." << std::endl;
+	return 1;
+}
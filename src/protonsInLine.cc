@@ -20,8 +20,7 @@
 #include <TApplication.h>
 #include <TCanvas.h>
 
-#include "../interface/Electron.h"
-#include "../interface/Proton.h"
+#include "../interface/ScatteringExperiment.h"
 
 #include "../interface/Pbar.h"
 
@@ -102,47 +101,23 @@ void printPhysicsInfo()
 }
 
 // Test for 6 protons; positions in p-p distances: -2.5, -1.5, -0.5, 0.5, 1.5, 2.5
-constexpr float protonPosition(int index) { return (-0.5f * NUMBER_OF_PROTONS + index + 0.5f) * PROTON_PROTON_DISTANCE; } 
+float protonPosition(int index) { return (-0.5f * NUMBER_OF_PROTONS + index + 0.5f) * PROTON_PROTON_DISTANCE; } 
 
-// Compile time proton position calculations
-template<int... i> 
-constexpr std::array<float, NUMBER_OF_PROTONS> fs() 
-{ 
-	return std::array<float, NUMBER_OF_PROTONS>{{ protonPosition(i)... }}; 
+// Target: the proton line on the x axis
+std::vector<vec3> protonLinePositions()
+{
+	std::vector<vec3> positions;
+	for(int protonIndex = 0; protonIndex < NUMBER_OF_PROTONS; ++protonIndex) positions.emplace_back(protonPosition(protonIndex), 0, 0);
+	return positions;
 }
-
-template<int...> 
-struct ProtonPosStruct;
-template<int... i> 
-struct ProtonPosStruct<0, i...>
-{ 
-	static constexpr std::array<float, NUMBER_OF_PROTONS> gs() 
-	{ 
-		return fs<0, i...>(); 
-	} 
-};
-template<int i, int... j> 
-struct ProtonPosStruct<i, j...>
-{ 
-	static constexpr std::array<float, NUMBER_OF_PROTONS> gs() 
-	{ 
-		return ProtonPosStruct<i-1, i, j...>::gs(); 
-	}
-};
-
-constexpr auto PROTONPOSITIONS = ProtonPosStruct<NUMBER_OF_PROTONS - 1>::gs();
-
-
+const ScatteringExperiment SCATTERING_EXPERIMENT(protonLinePositions());
 
 // Function declarations
 void physicsMain(int);
-void setProtonPositions();
-void setElectronStartPositionVelocity();
+vec3        electronStartPosition();
 void        initExperiment();
-// void        calculateForces();
-// void        updateParticles(const float& dt);
-const vec3& runExperiment();
-const vec3& runExperiment(int & numUpdates);
+const vec3  runExperiment();
+const vec3  runExperiment(int & numUpdates);
 void        clearExperiment();
 
 // Video
@@ -205,10 +180,10 @@ void physicsMain(int)
 		}
 		initExperiment();
 		vec3 electronHitPosition = runExperiment(numUpdates);
-		clearExperiment();
 		electronPositionsX.Fill(electronHitPosition.x);
 		totalNumUpdates += numUpdates;
 	}
+	clearExperiment();
 	std::cout << "\n\n";
 	auto end = time(NULL);
 	std::cout << "Took about: " << end - start << " second(s)." << std::endl;
@@ -219,21 +194,10 @@ void physicsMain(int)
 	theApp -> Run();
 }
 
-void setProtonPositions()
-{
-	for(int protonIndex = 0; protonIndex < NUMBER_OF_PROTONS; ++protonIndex)
-	{
-		const auto& proton = ChargedParticle::chargedParticleCollection[protonIndex];
-		proton -> setPosition(vec3(PROTONPOSITIONS[protonIndex], 0, 0));
-	}
-}
-
-// Electron x position: between two protons in the middle
-void setElectronStartPositionVelocity()
+// Beam source, electron x position: between two protons in the middle
+vec3 electronStartPosition()
 {
-	auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
 	float x, y, z;
-	float vx, vy, vz;
 	// Example for 6 protons:
 	// -2.5  -1.5  -0.5   0.5   1.5   2.5
 	//   p     p     p*****p     p     p
@@ -241,54 +205,28 @@ void setElectronStartPositionVelocity()
 	x = rand() / static_cast<double>(RAND_MAX) * PROTON_PROTON_DISTANCE - 0.5f * PROTON_PROTON_DISTANCE;
 	y = ELECTRON_START_PLANE_DISTANCE;
 	z = 0;
-	vx = 0;
-	vy = -ELECTRON_START_SPEED;
-	vz = 0;
-	electron -> setPosition(vec3( x,  y,  z));
-	electron -> setVelocity(vec3(vx, vy, vz));
+	return vec3(x, y, z);
 }
 
 // Initialize an experiment setup:
-// Two fixed protons and one electron moving towards them 
-// with randomized velocity and position
+// The fixed protons and one electron moving towards them 
+// with randomized position
 void initExperiment()
 {
-	for(int protonIndex = 0; protonIndex < NUMBER_OF_PROTONS; ++protonIndex)
-	{
-		new Proton();
-	}
-	new Electron();
-	setProtonPositions();
-	setElectronStartPositionVelocity();
+	SCATTERING_EXPERIMENT.init(electronStartPosition(), vec3(0, -ELECTRON_START_SPEED, 0));
 }
 
 // Contains calculations for the scattering processes
-const vec3& runExperiment()
+const vec3 runExperiment()
 {
-	while(1)
-	{
-		auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
-		electron -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-		electron -> update(DT_STEP);
-		const vec3& electronPosition = electron -> getPosition();
-		// std::cout << "Electron y: " << electronPosition.y() << std::endl;
-		if(electronPosition.y < -ELECTRON_END_PLANE_DISTANCE)
-		{
-			return electronPosition;
-		}
-	}
+	return SCATTERING_EXPERIMENT.run(DT_STEP, ScatteringExperiment::EndPlaneTermination{-ELECTRON_END_PLANE_DISTANCE}).hitPosition;
 }
-const vec3& runExperiment(int& numUpdates)
+// The video frames are taken by a sink of the experiment loop
+const vec3 runExperiment(int& numUpdates)
 {
 	static int saved = 0;
-	numUpdates = 0;
-	while(1)
+	auto saveVideoFrame = [] (const ChargedParticle&, const vec3&, const vec3&, const int& numUpdates)
 	{
-		numUpdates++;
-		auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
-		electron -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-		electron -> update(DT_STEP);
-		const vec3& electronPosition = electron -> getPosition();
 		if(ENABLE_VIDEO && saved < 20 && numUpdates % 300 == 0)
 		{
 			saved++;
@@ -312,19 +250,16 @@ const vec3& runExperiment(int& numUpdates)
 			free(pixels);
 			std::cout << "Saved." << std::endl;
 		}
-		// std::cout << "Electron y: " << electronPosition.y << std::endl;
-		if(electronPosition.y < -ELECTRON_END_PLANE_DISTANCE)
-		{
-			return electronPosition;
-		}
-	}
+	};
+	const ScatteringExperiment::Result result = SCATTERING_EXPERIMENT.run(DT_STEP, ScatteringExperiment::EndPlaneTermination{-ELECTRON_END_PLANE_DISTANCE}, saveVideoFrame);
+	numUpdates = result.numUpdates;
+	return result.hitPosition;
 }
 
 // Deletes particles in the experiment
 void clearExperiment()
 {
-	Particle::particleCollection.clear();
-	ChargedParticle::chargedParticleCollection.clear();
+	ScatteringExperiment::clear();
 }
 
 void initGL()
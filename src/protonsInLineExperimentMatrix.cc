@@ -4,6 +4,7 @@
 #include <GL/glu.h> 
 
 #include <cstdlib>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -12,6 +13,17 @@
 #include <vector>
 #include <memory>
 #include <utility>
+#include <numeric>
+#include <limits>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <map>
+#include <fstream>
+#include <csignal>
 #include <glm/glm.hpp>
 
 #include <TROOT.h>
@@ -24,6 +36,26 @@
 
 #include "../interface/Electron.h"
 #include "../interface/Proton.h"
+#include "../interface/BoundStateClassifier.h"
+#include "../interface/WorkStealingScheduler.h"
+#include "../interface/HistogramAccumulator.h"
+#include "../interface/PhiloxRandom.h"
+#include "../interface/SobolSequence.h"
+#include "../interface/ImpactParameterSampler.h"
+#include "../interface/MultilevelHistogramEstimator.h"
+#include "../interface/ControlVariateAccumulator.h"
+#include "../interface/AdaptiveHitMap.h"
+#include "../interface/ElectronBundle.h"
+#include "../interface/AbsorptionMap.h"
+#include "../interface/DetectorStage.h"
+#include "../interface/ScatteringExperiment.h"
+#include "../interface/ParameterGrid.h"
+#include "../interface/ResultCache.h"
+#include "../interface/BinarySerialization.h"
+#include "../interface/PeriodicTask.h"
+#include "../interface/UnixSocket.h"
+#include "../interface/TargetGeometry.h"
+#include "../interface/ElectronBunch.h"
 
 #include "../interface/Pbar.h"
 
@@ -32,6 +64,7 @@
 // Constants
 
 // const float COULOMB_CONSTANT                     = ChargedParticle::coulombConstant; // 1.00f
+constexpr float COULOMB_CONSTANT                      = 1.0f;                                     // same as the protected ChargedParticle::coulombConstant
 constexpr float SPEED_OF_LIGHT                        = 137;
 constexpr float ELECTRON_CHARGE                       = Electron::electronCharge;                // -1.0f
 constexpr float ELECTRON_MASS                         = Electron::electronMass;                  // 1.0f
@@ -41,11 +74,54 @@ constexpr float HARTREE_ENERGY_IN_EV                  = 27.211386f;
 constexpr float EV_TO_VELOCITY_SQUARED                = 2.0f / HARTREE_ENERGY_IN_EV;
 constexpr float HIDROGEN_BOND_LENGTH                  = 1.3983899f;                              // in Bohrs
 constexpr float DT_STEP                               = 1.0e-2f;
-constexpr int   NUM_EXPERIMENTS_PER_SETUP             = 1000;
-constexpr int   NUM_UPDATES_BEFORE_ABSORBTION_TESTING = 1e3;
-constexpr int   NUM_ITERATIONS_BETWEEN_ABS_TESTS      = 1e2;
+constexpr int   NUM_EXPERIMENTS_PER_SETUP             = 1000;                                     // with ADAPTIVE_STOPPING: experiments of the first round
+constexpr int   ADAPTIVE_STOPPING                     = 0;                                        // add rounds of experiments to a measurement point until TARGET_RELATIVE_PRECISION is reached
+constexpr float TARGET_RELATIVE_PRECISION             = 0.05f;                                    // relative error of the bins holding at least CONVERGENCE_MIN_BIN_FRACTION of the hits
+constexpr float CONVERGENCE_MIN_BIN_FRACTION          = 0.005f;
+constexpr int   MAX_EXPERIMENTS_PER_SETUP             = 50000;
+constexpr float RUN_TIME_BUDGET_SECONDS               = 0;                                        // > 0: share this wall-clock time between the measurement points (Neyman allocation in rounds)
+constexpr float BUDGET_ROUND_SECONDS                  = 60;                                       // length of a round, the matrix snapshot is updated after every round
+const char*     MATRIX_SNAPSHOT_FILE_NAME             = "matrixSnapshot.root";
+constexpr int   NUM_EXPERIMENTS_PER_BLOCK             = 10;                                       // unit of scheduling, results are merged per block
+constexpr int   NUM_WORKER_THREADS                    = 0;                                        // 0: one per hardware thread
+constexpr int   PIN_WORKER_THREADS                    = 0;                                        // 1: one CPU per worker, dealt out over the NUMA nodes, the target copied per node; processes sharing a machine should get disjoint CPUs (taskset)
+constexpr unsigned long long RANDOM_SEED              = 20151001;                                 // key of the counter-based random streams
+constexpr int   USE_QUASI_MONTE_CARLO                 = 0;                                        // start conditions from scrambled Sobol points instead of pseudo-random numbers
+constexpr int   NUM_INDEPENDENT_RANDOMISATIONS        = 10;                                       // replicates for the confidence intervals, consecutive experiments form a replicate
+constexpr int   NUM_EXPERIMENTS_PER_RANDOMISATION     = NUM_EXPERIMENTS_PER_SETUP / NUM_INDEPENDENT_RANDOMISATIONS;
+constexpr int   IMPACT_PARAMETER_NUM_STRATA           = 8;                                        // one stratum per proton cell of the start range
+constexpr int   USE_ANTITHETIC_PAIRS                  = 0;                                        // pairs of experiments starting at x and -x
+constexpr int   USE_IMPORTANCE_SAMPLING               = 0;                                        // start x drawn from impactParameterImportanceDensity(), weighted fills
+constexpr float IMPORTANCE_PEAK_HEIGHT                = 4.0f;                                     // relative to the uniform background
+constexpr float IMPORTANCE_PEAK_WIDTH                 = 0.1f * HIDROGEN_BOND_LENGTH;
+constexpr int   USE_SYMMETRY_REDUCTION                = 1;                                        // start conditions only from the fundamental domain of the detected mirror symmetries, histograms unfolded
+constexpr int   USE_ENERGY_SWEEP_LANES                = 0;                                        // common start conditions for every energy, integrated together in ElectronBundle lanes
+constexpr int   ENERGY_SWEEP_LANE_WIDTH               = 8;                                        // energies per bundle (lanes of the structure of arrays loops)
+constexpr int   USE_MULTILEVEL_MONTE_CARLO            = 0;                                        // hit distributions from coupled coarse/fine time step levels instead of DT_STEP only
+constexpr int   MULTILEVEL_NUM_LEVELS                 = 4;                                        // time steps DT_STEP * 2^(MULTILEVEL_NUM_LEVELS - 1), ..., 2 * DT_STEP, DT_STEP
+constexpr int   MULTILEVEL_NUM_PILOT_EXPERIMENTS      = 2 * NUM_EXPERIMENTS_PER_RANDOMISATION;   // per level, for the first variance and cost estimates
+constexpr int   USE_CONTROL_VARIATES                  = 0;                                        // hit positions of a cheap reduced trajectory model as control variates of the histogram bins
+constexpr int   CONTROL_VARIATE_NUM_Y_STEPS           = 200;                                      // steps of the reduced model from the start to the end plane
+constexpr float CONTROL_VARIATE_Y_STEP_SCALE          = 0.2f * HIDROGEN_BOND_LENGTH;              // the steps are uniform in asinh(y / scale): dense around the proton line
+constexpr int   CONTROL_VARIATE_QUADRATURE_POINTS     = 1 << 16;                                  // start x points for the exact expectation of the model's hit histogram
+constexpr int   USE_ABSORPTION_PREDICTOR              = 0;                                        // start conditions in cells that absorbed every attempt so far are integrated only with ABSORPTION_SURVIVAL_PROBABILITY
+constexpr int   ABSORPTION_MAP_X_CELLS                = 128;                                      // cells of the start x range, times SURROGATE_NUM_Z_VELOCITY_SLICES cells of the z velocity
+constexpr int   ABSORPTION_MAP_MIN_ATTEMPTS           = 20;                                       // integrated attempts of a cell before it can be predicted to absorb: 20 of 20 absorbed bound the hit fraction below 15% (95% confidence)
+constexpr float ABSORPTION_SURVIVAL_PROBABILITY       = 0.1f;                                     // start conditions predicted to absorb are still integrated with this probability and weighted by its inverse
+constexpr int   ABSORPTION_PILOT_EXPERIMENTS          = 2 * NUM_EXPERIMENTS_PER_RANDOMISATION;   // first round, learning the absorption map without predictions
+constexpr int   BOUND_STATE_MIN_PERIAPSES             = 2;                                        // periapses with negative energy before an electron counts as absorbed
+constexpr float BOUND_STATE_REGION_MARGIN             = 2.0f * HIDROGEN_BOND_LENGTH;              // bound state region: proton bounding box extended by this margin
 constexpr int   NUMBER_OF_PROTONS                     = 20;                                       // should be even
 constexpr float PROTON_PROTON_DISTANCE                = HIDROGEN_BOND_LENGTH;
+// Target: the charges of TARGET_FILE_NAME if set, a lattice of NUMBER_OF_PROTONS protons along x spaced by PROTON_PROTON_DISTANCE otherwise
+// (electrons deflected by a sheet of several rows can orbit it far outside the bound state region, where they are not absorbed)
+enum TargetLattice { PROTON_LINE, SQUARE_SHEET, HEXAGONAL_SHEET, CUBIC_CRYSTAL };
+constexpr TargetLattice TARGET_LATTICE                = PROTON_LINE;
+constexpr int   TARGET_LATTICE_ROWS                   = 1;                                        // sheets and crystals: rows along z
+constexpr int   TARGET_LATTICE_LAYERS                 = 1;                                        // crystals: layers along y
+constexpr float TARGET_VACANCY_FRACTION               = 0.0f;                                     // crystals: empty sites, drawn from RANDOM_SEED
+const char*     TARGET_FILE_NAME                      = "";                                       // ".xyz" text or the binary format of TargetGeometry::writeBinary()
+constexpr float TARGET_XYZ_LENGTH_UNIT                = 1.0f;                                     // bohrs per length unit of the .xyz files, 1.8897261 for angstroms
 constexpr float ELECTRON_START_X_POS_MIN              = -4.0f * HIDROGEN_BOND_LENGTH;
 constexpr float ELECTRON_START_X_POS_MAX              = +4.0f * HIDROGEN_BOND_LENGTH;
 constexpr float ELECTRON_START_PLANE_DISTANCE         = 50.0f  * HIDROGEN_BOND_LENGTH;
@@ -63,6 +139,35 @@ constexpr float END_POS_NUM_BINS                      = 600;
 
 // Screenshots/video
 constexpr int   SAVE_2D_SCREENSHOTS                   = 1;
+
+// Detector stage: crossings of DETECTOR_SURFACES recorded along every trajectory, one histogram per observable
+constexpr int   USE_DETECTOR_STAGE                    = 0;
+const char*     DETECTOR_OBSERVABLES_FILE_NAME        = "detectorObservables.root";
+// The experiment ends at the end plane, surfaces behind it are never crossed
+const std::vector<DetectorSurface> DETECTOR_SURFACES  =
+{
+	{DetectorSurface::PLANE,  vec3(0.0f, -ELECTRON_END_PLANE_DISTANCE, 0.0f),        vec3(0.0f, 1.0f, 0.0f), 0.0f,                                "endPlane"},
+	{DetectorSurface::PLANE,  vec3(0.0f, -0.5f * ELECTRON_END_PLANE_DISTANCE, 0.0f), vec3(0.0f, 1.0f, 0.0f), 0.0f,                                "middlePlane"},
+	{DetectorSurface::SPHERE, vec3(0.0f, 0.0f, 0.0f),                                vec3(0.0f, 0.0f, 0.0f), 0.75f * ELECTRON_END_PLANE_DISTANCE, "sphere"}
+};
+const std::vector<DetectorObservable> DETECTOR_OBSERVABLES =
+{
+	{"endPlaneX",              0, DetectorObservable::POSITION_X,       static_cast<int>(END_POS_NUM_BINS), END_POS_MIN_RANGE, END_POS_MAX_RANGE},
+	{"endPlaneKineticEnergy",  0, DetectorObservable::KINETIC_ENERGY,   200, 0.0,               2.0 * ELECTRON_START_KINETIC_ENERGY_EV_MAX / HARTREE_ENERGY_IN_EV},
+	{"endPlaneTimeOfFlight",   0, DetectorObservable::TIME_OF_FLIGHT,   200, 0.0,               4.0 * (ELECTRON_START_PLANE_DISTANCE + ELECTRON_END_PLANE_DISTANCE) / std::sqrt(ELECTRON_START_KINETIC_ENERGY_EV_MIN * EV_TO_VELOCITY_SQUARED)},
+	{"middlePlaneX",           1, DetectorObservable::POSITION_X,       static_cast<int>(END_POS_NUM_BINS), END_POS_MIN_RANGE, END_POS_MAX_RANGE},
+	{"sphereScatteringAngle",  2, DetectorObservable::SCATTERING_ANGLE, 360, 0.0,               M_PI}
+};
+const DetectorStage DETECTOR_STAGE(DETECTOR_SURFACES, DETECTOR_OBSERVABLES, vec3(0.0f, -1.0f, 0.0f));
+
+// Surrogate map: hit histograms from an adaptively refined start x -> hit x map instead of random experiments
+constexpr int   USE_SURROGATE_MAP                     = 0;
+constexpr int   SURROGATE_INITIAL_NODES               = 129;
+constexpr int   SURROGATE_MAX_NODES                   = 20000;                                    // full experiments per map at most
+constexpr int   SURROGATE_NUM_Z_VELOCITY_SLICES       = SAVE_2D_SCREENSHOTS ? 8 : 1;              // one map per z velocity (midpoint rule)
+constexpr float SURROGATE_MIN_START_X_STEP            = 1.0e-5f * HIDROGEN_BOND_LENGTH;
+constexpr float SURROGATE_MAX_HIT_STEP                = 0.5f * (END_POS_MAX_RANGE - END_POS_MIN_RANGE) / END_POS_NUM_BINS; // half a histogram bin
+
 constexpr float ELECTRON_START_Z_POS_MIN              = -0.05f * HIDROGEN_BOND_LENGTH;                 // only matters when SAVE_2D_SCREENSHOTS is set
 constexpr float ELECTRON_START_Z_POS_MAX              = +0.05f * HIDROGEN_BOND_LENGTH;                 // only matters when SAVE_2D_SCREENSHOTS is set
 constexpr float SCREENSHOTS_X_POS_MIN_RANGE           = END_POS_MIN_RANGE;
@@ -72,23 +177,120 @@ constexpr float SCREENSHOTS_Z_POS_MIN_RANGE           = END_POS_MIN_RANGE;
 constexpr float SCREENSHOTS_Z_POS_MAX_RANGE           = END_POS_MAX_RANGE;
 constexpr float SCREENSHOTS_Z_BIN_NUMBER              = 6000;
 constexpr float SCREENSHOTS_MARKERSIZES               = 0.5;
+// Parameter sweep: every combination of the numbers of protons, the proton-proton distances and the energies above
+constexpr int   USE_PARAMETER_SWEEP                   = 0;                                        // run the sweep grid in this process instead of the single proton line above
+const std::vector<int>   SWEEP_NUMBERS_OF_PROTONS     = {10, 20};                                 // should be even
+const std::vector<float> SWEEP_PROTON_PROTON_DISTANCES = {0.75f * HIDROGEN_BOND_LENGTH, HIDROGEN_BOND_LENGTH, 1.5f * HIDROGEN_BOND_LENGTH};
+const char*     PARAMETER_SWEEP_FILE_NAME             = "parameterSweep.root";
+// Result cache: measurement points already simulated with the same configuration are loaded instead of simulated
+constexpr int   USE_RESULT_CACHE                      = 0;                                        // not used by budgeted runs, multilevel Monte Carlo, surrogate maps and energy sweep lanes
+const char*     RESULT_CACHE_DIRECTORY                = "resultCache";
+constexpr int   RESULT_CACHE_ENGINE_VERSION           = 2;                                        // increase on every change of the physics, sampling or estimator code: old entries are not used any more
+// Checkpoints: the state of a run is written periodically and after every round, --resume continues the run from it
+constexpr float CHECKPOINT_INTERVAL_SECONDS           = 600;                                      // 0: no checkpoints, not written by the runs the result cache does not support either
+const char*     CHECKPOINT_FILE_NAME                  = "matrixCheckpoint.bin";
+// Sharded runs: --shard <i> <n> runs the randomisations i, i + n, ... and writes them to SHARD_FILE_NAME_PREFIX_<i>_of_<n>.bin,
+// --merge <shard files...> combines any set of shard files into the results of the run
+const char*     SHARD_FILE_NAME_PREFIX                = "matrixShard";
+// Job server: --serve [socket path] answers the requests of bin/matrixJobClient, every request runs NUM_EXPERIMENTS_PER_SETUP
+// experiments of a proton line and a measurement point energy as the parameter sweep does
+const char*     JOB_SERVER_SOCKET_NAME                = "protonsInLineExperimentMatrix.socket";   // in the user's runtime directory (see UnixSocket::userRuntimePath), default of the client as well
+constexpr float JOB_SERVER_SLICE_PROTON_UPDATES       = 4.0e6f;                                   // expected cost (updates times protons) of a turn of a job, per worker thread
+constexpr float JOB_SERVER_REQUEST_TIMEOUT_SECONDS    = 5;                                        // a connection is closed if its request line is not complete by then
+constexpr int   JOB_SERVER_MAX_REQUEST_LENGTH         = 1024;                                     // longer request lines are refused
+constexpr int   JOB_SERVER_MAX_PROTONS                = 10000;                                    // the limits of the requested targets
+constexpr float JOB_SERVER_MAX_PROTON_DISTANCE        = 1000.0f;                                  // bohr
+constexpr int   JOB_SERVER_MAX_CACHED_TARGETS         = 16;                                       // targets kept for the following jobs, the least recently used one is dropped first
+// Beam bunches: instead of single electrons, BEAM_NUM_BUNCHES bunches of BEAM_BUNCH_NUM_ELECTRONS electrons per measurement point
+// traverse the target together, repelling each other (space charge). Every bunch gets its own hit histogram (and detector
+// observable histograms with USE_DETECTOR_STAGE), written to BEAM_BUNCHES_FILE_NAME together with their sums.
+constexpr int   USE_BEAM_BUNCHES                      = 0;
+constexpr int   BEAM_NUM_BUNCHES                      = 16;                                       // per measurement point, the replicates of the error bars
+constexpr int   BEAM_BUNCH_NUM_ELECTRONS              = 1000;
+constexpr float BEAM_BUNCH_LENGTH                     = 10.0f * HIDROGEN_BOND_LENGTH;             // along y, behind the start plane
+constexpr float BEAM_BUNCH_WIDTH                      = 8.0f * HIDROGEN_BOND_LENGTH;              // along z, centered; along x the bunch fills the start x range
+constexpr int   BEAM_SPACE_CHARGE                     = 1;                                        // 0: independent electrons, for comparison
+constexpr float BEAM_TREE_OPENING_ANGLE               = 0.5f;                                     // of the Barnes-Hut tree of the electron-electron field, 0: direct sum
+constexpr float BEAM_MAX_UPDATES_FACTOR               = 4.0f;                                     // electrons still flying after this many times the updates of a single electron are counted as lost
+const char*     BEAM_BUNCHES_FILE_NAME                = "beamBunches.root";
+
+static_assert(2 <= NUM_INDEPENDENT_RANDOMISATIONS && NUM_EXPERIMENTS_PER_SETUP % NUM_INDEPENDENT_RANDOMISATIONS == 0, "The experiments must split evenly into at least two randomisations.");
+static_assert(NUM_EXPERIMENTS_PER_RANDOMISATION % NUM_EXPERIMENTS_PER_BLOCK == 0, "A block of experiments must not span two randomisations.");
+static_assert(MAX_EXPERIMENTS_PER_SETUP % NUM_EXPERIMENTS_PER_RANDOMISATION == 0, "The maximal number of experiments must consist of whole randomisations.");
+static_assert(1 <= MULTILEVEL_NUM_LEVELS && MULTILEVEL_NUM_PILOT_EXPERIMENTS % NUM_EXPERIMENTS_PER_RANDOMISATION == 0, "The pilot of a time step level must consist of whole randomisations.");
 
 
-// Test for 6 protons; positions in p-p distances: -2.5, -1.5, -0.5, 0.5, 1.5, 2.5
-constexpr float protonPosition(int index) { return (-0.5f * NUMBER_OF_PROTONS + index + 0.5f) * PROTON_PROTON_DISTANCE; } 
-const std::vector<float> PROTONPOSITIONS(NUMBER_OF_PROTONS, 0);
 constexpr float electronStartVelocity(int index) { return sqrt((ELECTRON_START_KINETIC_ENERGY_EV_MIN + (index * ELECTRON_START_KINETIC_ENERGY_EV_STEP)) * EV_TO_VELOCITY_SQUARED); } 
 const std::vector<float> ELECTRON_START_VELOCITIES(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, 0);
 constexpr float electronStartKineticEnergy(int index) { return (ELECTRON_START_KINETIC_ENERGY_EV_MIN + (index * ELECTRON_START_KINETIC_ENERGY_EV_STEP)); } 
 const std::vector<float> ELECTRON_START_KIN_ENERGIES(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, 0);
 
-void initConsts()
+// Target of the experiments, see TARGET_LATTICE and TARGET_FILE_NAME. A file that can not be read ends the program.
+// Test for 6 protons in a line; positions in p-p distances: -2.5, -1.5, -0.5, 0.5, 1.5, 2.5
+TargetGeometry createTarget()
+{
+	if(std::strlen(TARGET_FILE_NAME) == 0)
+	{
+		switch(TARGET_LATTICE)
+		{
+			case SQUARE_SHEET:    return TargetGeometry::squareSheet   (NUMBER_OF_PROTONS, TARGET_LATTICE_ROWS, PROTON_PROTON_DISTANCE, PROTON_CHARGE);
+			case HEXAGONAL_SHEET: return TargetGeometry::hexagonalSheet(NUMBER_OF_PROTONS, TARGET_LATTICE_ROWS, PROTON_PROTON_DISTANCE, PROTON_CHARGE);
+			case CUBIC_CRYSTAL:   return TargetGeometry::cubicCrystal  (NUMBER_OF_PROTONS, TARGET_LATTICE_LAYERS, TARGET_LATTICE_ROWS, PROTON_PROTON_DISTANCE, PROTON_CHARGE, TARGET_VACANCY_FRACTION, RANDOM_SEED);
+			default:              return TargetGeometry::line          (NUMBER_OF_PROTONS, PROTON_PROTON_DISTANCE, PROTON_CHARGE);
+		}
+	}
+	std::string error;
+	TargetGeometry target = TargetGeometry::load(TARGET_FILE_NAME, TARGET_XYZ_LENGTH_UNIT, error);
+	if(target.isEmpty())
+	{
+		std::cout << "Error: " << (error.empty() ? std::string("no charges in ") + TARGET_FILE_NAME : error) << "." << std::endl;
+		std::exit(1);
+	}
+	return target;
+}
+const TargetGeometry TARGET = createTarget();
+const ScatteringExperiment SCATTERING_EXPERIMENT(TARGET);
+
+// Unnormalized sampling density of the start x positions: uniform background with peaks under the target charges
+double impactParameterImportanceDensity(const double& x)
 {
-	for(auto index: range(PROTONPOSITIONS.size()))
+	double density = 1.0;
+	for(int chargeIndex = 0; chargeIndex < TARGET.getNumCharges(); ++chargeIndex)
 	{
-		float& unconst_element = const_cast<float&>(PROTONPOSITIONS[index]);
-		unconst_element = protonPosition(index);
+		const double distance = (x - TARGET.getPositions()[chargeIndex].x) / IMPORTANCE_PEAK_WIDTH;
+		density += IMPORTANCE_PEAK_HEIGHT * std::exp(-0.5 * distance * distance);
 	}
+	return density;
+}
+// Mirror symmetries of the target, the incident beam and the detector stage, checked on the geometry:
+//  - x -> -x: target, start x range and histogram range symmetric around 0 (the importance density follows the target),
+//  - z -> -z: target and z velocity range symmetric around 0, only drawn with SAVE_2D_SCREENSHOTS.
+// A finite lattice has no translation symmetry, its edges break it.
+struct StartSymmetries
+{
+	int mirrorX;
+	int mirrorZ;
+};
+StartSymmetries detectStartSymmetries()
+{
+	const float tolerance = 1.0e-5f * PROTON_PROTON_DISTANCE;
+	bool mirrorX = std::abs(ELECTRON_START_X_POS_MIN + ELECTRON_START_X_POS_MAX) < tolerance && std::abs(END_POS_MIN_RANGE + END_POS_MAX_RANGE) < tolerance && TARGET.isMirrorSymmetric(0, tolerance);
+	bool mirrorZ = SAVE_2D_SCREENSHOTS && std::abs(ELECTRON_START_Z_POS_MIN + ELECTRON_START_Z_POS_MAX) < tolerance && TARGET.isMirrorSymmetric(2, tolerance);
+	if(USE_DETECTOR_STAGE)
+	{
+		mirrorX = mirrorX && DETECTOR_STAGE.isMirrorSymmetric(0, tolerance);
+		mirrorZ = mirrorZ && DETECTOR_STAGE.isMirrorSymmetric(2, tolerance);
+	}
+	return StartSymmetries{USE_SYMMETRY_REDUCTION && mirrorX, USE_SYMMETRY_REDUCTION && mirrorZ};
+}
+const StartSymmetries START_SYMMETRIES = detectStartSymmetries();
+// Fundamental domain of the start x: x >= 0 with the x mirror symmetry
+const float ELECTRON_START_X_SAMPLING_MIN = START_SYMMETRIES.mirrorX ? 0.0f : ELECTRON_START_X_POS_MIN;
+const ImpactParameterSampler IMPACT_PARAMETER_SAMPLER(ELECTRON_START_X_SAMPLING_MIN, ELECTRON_START_X_POS_MAX, NUM_EXPERIMENTS_PER_RANDOMISATION, IMPACT_PARAMETER_NUM_STRATA, USE_ANTITHETIC_PAIRS,
+	USE_IMPORTANCE_SAMPLING ? ImpactParameterSampler::Density(impactParameterImportanceDensity) : ImpactParameterSampler::Density());
+
+void initConsts()
+{
 	for(auto index: range(ELECTRON_START_VELOCITIES.size()))
 	{
 		float& unconst_element = const_cast<float&>(ELECTRON_START_VELOCITIES[index]);
@@ -106,11 +308,52 @@ void printPhysicsInfo()
 	std::cout << "---------------------------\n";
 	std::cout << "Experiment setup data:\n";
 	std::cout << "Num. experiments per measurement points:     " << NUM_EXPERIMENTS_PER_SETUP << "\n";
+	if(0 < RUN_TIME_BUDGET_SECONDS)
+	{
+		std::cout << "Run time budget:                             " << RUN_TIME_BUDGET_SECONDS << " s in rounds of " << BUDGET_ROUND_SECONDS << " s\n";
+	}
+	if(ADAPTIVE_STOPPING)
+	{
+		std::cout << "Adaptive stopping, target rel. precision:    " << TARGET_RELATIVE_PRECISION << " (at most " << MAX_EXPERIMENTS_PER_SETUP << " experiments)\n";
+	}
 	std::cout << "DT step:                                     " << DT_STEP                   << "\n";
-	std::cout << "Number of fixed protons:                     " << NUMBER_OF_PROTONS         << "\n";
-	std::cout << "Proton arrangement:                          " << "SINGLE_LINE"             << "\n";
-	std::cout << "Proton-proton distance:                      " << PROTON_PROTON_DISTANCE    << "\n";
-	std::cout << "Proton-proton distance in H bond lengths:    " << std::fixed << std::setprecision(2) << PROTON_PROTON_DISTANCE / HIDROGEN_BOND_LENGTH << "\n";
+	if(USE_MULTILEVEL_MONTE_CARLO)
+	{
+		std::cout << "Multilevel Monte Carlo time step levels:     " << MULTILEVEL_NUM_LEVELS << " (coarsest DT step " << DT_STEP * (1 << (MULTILEVEL_NUM_LEVELS - 1)) << ")\n";
+	}
+	std::cout << "Number of fixed charges:                     " << TARGET.getNumCharges()    << "\n";
+	std::cout << "Target:                                      " << TARGET.getDescription()   << "\n";
+	if(std::strlen(TARGET_FILE_NAME) == 0)
+	{
+		std::cout << "Proton-proton distance:                      " << PROTON_PROTON_DISTANCE    << "\n";
+		std::cout << "Proton-proton distance in H bond lengths:    " << std::fixed << std::setprecision(2) << PROTON_PROTON_DISTANCE / HIDROGEN_BOND_LENGTH << "\n";
+	}
+	std::cout << "Start condition sampling:                    " << (USE_QUASI_MONTE_CARLO ? "SCRAMBLED_SOBOL" : "PSEUDO_RANDOM") << "\n";
+	std::cout << "Independent randomisations:                  " << NUM_INDEPENDENT_RANDOMISATIONS << "\n";
+	std::cout << "Impact parameter strata:                     " << IMPACT_PARAMETER_NUM_STRATA << "\n";
+	std::cout << "Sampled mirror symmetry domain (x, z):       " << START_SYMMETRIES.mirrorX << ", " << START_SYMMETRIES.mirrorZ << "\n";
+	std::cout << "Antithetic pairs, importance sampling:       " << USE_ANTITHETIC_PAIRS << ", " << USE_IMPORTANCE_SAMPLING << "\n";
+	std::cout << "Reduced model control variates:              " << USE_CONTROL_VARIATES << "\n";
+	std::cout << "Common start conditions for all energies:    " << USE_ENERGY_SWEEP_LANES << "\n";
+	if(USE_SURROGATE_MAP)
+	{
+		std::cout << "Surrogate maps, z velocity slices, max nodes: " << SURROGATE_NUM_Z_VELOCITY_SLICES << ", " << SURROGATE_MAX_NODES << "\n";
+		std::cout << "Surrogate map bin errors:                    interpolation-difference indicator, not statistical errors\n";
+	}
+	std::cout << "Bound state min. periapses:                  " << BOUND_STATE_MIN_PERIAPSES << "\n";
+	if(USE_BEAM_BUNCHES)
+	{
+		std::cout << "Beam bunches, electrons per bunch:           " << BEAM_NUM_BUNCHES << ", " << BEAM_BUNCH_NUM_ELECTRONS << "\n";
+		std::cout << "Space charge, tree opening angle:            " << BEAM_SPACE_CHARGE << ", " << BEAM_TREE_OPENING_ANGLE << "\n";
+	}
+	if(USE_PARAMETER_SWEEP)
+	{
+		std::cout << "Parameter sweep, numbers of protons:         ";
+		for(const auto& numberOfProtons: SWEEP_NUMBERS_OF_PROTONS) std::cout << numberOfProtons << " ";
+		std::cout << "\nParameter sweep, proton-proton distances:    ";
+		for(const auto& protonProtonDistance: SWEEP_PROTON_PROTON_DISTANCES) std::cout << protonProtonDistance << " ";
+		std::cout << "\n";
+	}
 	std::cout << "Number of measurement points:                " << ELECTRON_START_KIN_EN_NUM_MEAS_POINTS << "\n";
 	std::cout << "Measurement point list:\n";
 	int i = 0;
@@ -127,15 +370,170 @@ void printPhysicsInfo()
 }
 
 // Function declarations
-void        physicsMain();
-void        setProtonPositions();
-void        setElectronStartPositionVelocity(const int& numSetup);
-void        initExperiment(const int& numSetup);
+// Command line options of the experiment matrix run
+struct RunOptions
+{
+	bool                     resume     = false;
+	int                      shardIndex = 0;
+	int                      numShards  = 1;
+	std::vector<std::string> mergeFileNames;
+	std::string              serverSocketPath;
+};
+void        physicsMain(const RunOptions& options);
+// Start position x, uniform [0, 1) number of the z velocity and the weight of the experiment in every histogram
+struct StartConditions
+{
+	float  x;
+	float  zVelocitySample;
+	double weight;
+};
+void            electronStartPositionVelocity(const int& numSetup, const StartConditions& startConditions, vec3& position, vec3& velocity);
+void            initExperiment(const int& numSetup, const StartConditions& startConditions, const ScatteringExperiment& experiment = SCATTERING_EXPERIMENT);
+void            drawStartConditionSamples(const int& numSetup, const int& experimentNumber, const int& attempt, PhiloxRandom& randomGenerator, double* uniformSamples);
+StartConditions drawStartConditions(const int& numSetup, const int& experimentNumber, const int& attempt, PhiloxRandom& randomGenerator);
 // void        calculateForces();
 // void        updateParticles(const float& dt);
 void       drawSampleElectronPaths(const int& numPaths);
-const vec3 runExperiment(int& numUpdates, int& experimentSuccesful);
+const vec3 runExperiment(int& numUpdates, int& experimentSuccesful, const float& dt = DT_STEP, std::vector<DetectorCrossing>* crossings = nullptr);
+const vec3 runExperiment(const ScatteringExperiment& experiment, const BoundStateClassifier& absorptionClassifierPrototype, int& numUpdates, int& experimentSuccesful,
+	const float& dt = DT_STEP, std::vector<DetectorCrossing>* crossings = nullptr);
 void       clearExperiment();
+BoundStateClassifier createAbsorptionClassifier(const ScatteringExperiment& experiment = SCATTERING_EXPERIMENT);
+PhiloxRandom createExperimentRandomGenerator(const int& numSetup, const int& experimentNumber);
+void         replayExperiment(const int& numSetup, const int& experimentNumber);
+
+// Results of a fixed block of experiments of a measurement point.
+// Each block is processed by a single worker thread, the blocks are merged in block index order
+// afterwards, so the results do not depend on the number of threads.
+struct ExperimentBlockResult
+{
+	HistogramAccumulator                 electronPositionsX = HistogramAccumulator(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+	long long                            totalNumUpdates    = 0;
+	int                                  electronsAbsorbed  = 0;
+	std::vector<std::pair<float, float>> screenshotHits;
+	std::vector<double>                  screenshotWeights;
+	ControlVariateAccumulator            modelControl    = ControlVariateAccumulator(USE_CONTROL_VARIATES ? END_POS_NUM_BINS : 0, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+	std::vector<AbsorptionMap::Attempt>  absorptionAttempts;                                     // integrated attempts, with USE_ABSORPTION_PREDICTOR only
+	int                                  startsRejected     = 0;                                 // experiments ended without integration because their start conditions were predicted to absorb
+	std::vector<HistogramAccumulator>    observableHistograms = USE_DETECTOR_STAGE ? DETECTOR_STAGE.createHistograms() : std::vector<HistogramAccumulator>();
+	int                                  finished           = 0;                                 // set under checkpointMutex, only finished blocks are checkpointed
+};
+long long runExperimentBlock(const int& numSetup, const int& firstExperiment, const int& numExperiments, const AbsorptionMap& absorptionMap, ExperimentBlockResult& result);
+void      recordHit(const int& numSetup, const StartConditions& startConditions, const StartConditions& firstStartConditions, const vec3& electronHitPosition, const int& numUpdates, ExperimentBlockResult& result);
+void      runExperimentLanes(ElectronBundle<ENERGY_SWEEP_LANE_WIDTH>& electrons, std::vector<BoundStateClassifier>& absorptionClassifiers, const int& firstSetup, const StartConditions& startConditions,
+	vec3* hitPositions, int* numUpdates, int* experimentsSuccesful);
+long long runEnergySweepBlock(const int& firstExperiment, const int& numExperiments, std::vector<ExperimentBlockResult*>& results);
+
+// Results of a measurement point, collected over one or more rounds of experiments.
+// Block i holds the experiments [i * NUM_EXPERIMENTS_PER_BLOCK, (i + 1) * NUM_EXPERIMENTS_PER_BLOCK),
+// the blocks are merged in index order into the replicates (randomisations).
+struct MeasurementPointResult
+{
+	std::vector<ExperimentBlockResult> blockResults;
+	std::vector<HistogramAccumulator>  electronPositionsXReplicates;
+	std::vector<ControlVariateAccumulator> modelControlReplicates;
+	std::vector<double>                modelHitProbabilities; // expectation of the control histogram of one experiment
+	AbsorptionMap                      absorptionMap     = AbsorptionMap(ABSORPTION_MAP_X_CELLS, SURROGATE_NUM_Z_VELOCITY_SLICES, ELECTRON_START_X_SAMPLING_MIN, ELECTRON_START_X_POS_MAX, ABSORPTION_MAP_MIN_ATTEMPTS);
+	long long                          startsRejected    = 0;
+	std::vector<HistogramAccumulator>  observableHistograms = USE_DETECTOR_STAGE ? DETECTOR_STAGE.createHistograms() : std::vector<HistogramAccumulator>();
+	int                                numBlocksMerged   = 0;
+	int                                numCachedExperiments = 0;                           // loaded from the result cache, without block results
+	long long                          totalNumUpdates   = 0;
+	int                                electronsAbsorbed = 0;
+	double                             relativePrecision = 0.0;
+	int                                converged         = 0;
+	int getNumExperiments() const { return numCachedExperiments + blockResults.size() * NUM_EXPERIMENTS_PER_BLOCK; }
+};
+void      mergeNewBlockResults(MeasurementPointResult& pointResult);
+HistogramAccumulator estimateHistogram(const MeasurementPointResult& pointResult);
+void      copyToMatrixRow(HistogramAccumulator electronPositionsX, const int& numExperiments, TH2D& matrix_H, const int& measurementPointIndex);
+HistogramAccumulator unfoldSymmetries(const HistogramAccumulator& electronPositionsX, const std::vector<double>& mirrorCovariances = std::vector<double>());
+std::vector<HistogramAccumulator> unfoldSymmetries(std::vector<HistogramAccumulator> electronPositionsXReplicates);
+double    reducedModelHitX(const int& numSetup, const double& startX);
+std::vector<double> calculateModelHitProbabilities(const int& numSetup);
+double    calculateRelativePrecision(const HistogramAccumulator& electronPositionsX);
+int       numExperimentsInNextRound(const MeasurementPointResult& pointResult);
+std::vector<int> allocateBudgetRound(const std::vector<MeasurementPointResult>& pointResults, const std::vector<CostStatistics>& blockCosts, const double& roundBudgetUpdates);
+void      writeMatrixSnapshot(const std::vector<MeasurementPointResult>& pointResults);
+void      writeDetectorObservables(const std::vector<MeasurementPointResult>& pointResults);
+std::string measurementPointCacheKey(const int& numSetup, const ScatteringExperiment& experiment, const std::string& estimator);
+void      writeBlockResult(std::ostream& stream, const ExperimentBlockResult& blockResult);
+bool      readBlockResult(std::istream& stream, ExperimentBlockResult& blockResult);
+void      writeCheckpoint(const std::vector<MeasurementPointResult>& pointResults, const int& round);
+bool      readCheckpoint(std::vector<MeasurementPointResult>& pointResults, int& round);
+bool      isShardable();
+void      shardBlockRange(const int& shardIndex, const int& numShards, int& firstBlock, int& lastBlock);
+void      runShard(WorkStealingScheduler& scheduler, const int& shardIndex, const int& numShards);
+bool      mergeShardFiles(const std::vector<std::string>& fileNames, std::vector<MeasurementPointResult>& pointResults);
+bool      isCacheable(const int& numSetup);
+bool      loadFromResultCache(const ResultCache& resultCache, const std::string& key, MeasurementPointResult& pointResult);
+void      storeInResultCache(const ResultCache& resultCache, const std::string& key, const MeasurementPointResult& pointResult);
+
+// Set by Ctrl-c during a budgeted run: the run stops after the current round
+volatile std::sig_atomic_t stopRequested = 0;
+void requestStop(int) { stopRequested = 1; }
+// Guards the finished flags of the block results, read by the checkpoint writer while the workers run
+std::mutex checkpointMutex;
+double    expectedNumUpdatesPerExperiment(const int& numSetup);
+
+// Samples of one time step level of a measurement point, computed by a single worker thread
+struct MultilevelBlockResult
+{
+	LevelDifferenceAccumulator levelSums         = LevelDifferenceAccumulator(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+	int                        electronsAbsorbed = 0;
+};
+float     multilevelTimeStep(const int& level);
+long long runMultilevelExperimentBlock(const int& numSetup, const int& level, const int& firstExperiment, const int& numExperiments, MultilevelBlockResult& result);
+std::vector<HistogramAccumulator> runMultilevelMonteCarlo(WorkStealingScheduler& scheduler);
+std::vector<HistogramAccumulator> runSurrogateMaps(WorkStealingScheduler& scheduler);
+
+// Target shared by the sweep points of a geometry: the proton arrangement and the absorption region around it
+struct SweepTarget
+{
+	ScatteringExperiment experiment;
+	BoundStateClassifier absorptionClassifier; // copied for every experiment
+};
+long long runSweepBlock(const SweepTarget& target, const int& numSetup, const int& firstExperiment, const int& numExperiments, ExperimentBlockResult& result);
+void      runParameterSweep(WorkStealingScheduler& scheduler);
+// A request of a job server client: the experiments of the parameter sweep at a single grid point
+struct ServerJob
+{
+	int                    id;
+	int                    numberOfProtons;
+	float                  protonProtonDistance;
+	int                    numSetup;
+	UnixSocket             connection;
+	const SweepTarget*     target             = nullptr; // set when the job is started
+	MeasurementPointResult pointResult;
+	std::string            cacheKey;
+	int                    numBlocksScheduled = 0;
+};
+// Jobs handed from the server's listening thread to its dispatcher thread
+struct ServerJobQueue
+{
+	std::mutex                              queueMutex;
+	std::condition_variable                 jobQueued;
+	std::deque<std::unique_ptr<ServerJob>>  jobs;
+	int                                     numJobsRunning = 0;
+	bool                                    stopping       = false;
+};
+void      runJobServer(WorkStealingScheduler& scheduler, const std::string& socketPath);
+void      handleServerRequest(const std::string& request, UnixSocket& connection, ServerJobQueue& queue, int& numJobsSubmitted, const int& numWorkerThreads);
+void      dispatchServerJobs(WorkStealingScheduler& scheduler, ServerJobQueue& queue);
+void      finishServerJob(ServerJob& job, const ResultCache* resultCache);
+void      printConfidenceIntervalSummary(const int& numSetup, const HistogramAccumulator& electronPositionsX, const int& numReplicates);
+// Results of a bunch of electrons of a measurement point
+struct BeamBunchResult
+{
+	HistogramAccumulator              electronPositionsX   = HistogramAccumulator(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+	std::vector<HistogramAccumulator> observableHistograms = USE_DETECTOR_STAGE ? DETECTOR_STAGE.createHistograms() : std::vector<HistogramAccumulator>();
+	int                               numUpdates           = 0;
+	int                               electronsHit         = 0;
+	int                               electronsAbsorbed    = 0;
+	int                               electronsLost        = 0; // repelled back behind the bunch's start region or still flying at the update limit
+};
+void      runBeamBunch(const int& numSetup, const int& bunchIndex, BeamBunchResult& result);
+void      runBeamBunches(WorkStealingScheduler& scheduler);
 
 TApplication* theApp = nullptr;
 
@@ -143,16 +541,80 @@ int main(int argc, char **argv)
 {
 	std::cout << argv[0] << " started..." << std::endl;
 	initConsts();
+	// Usage for debugging a single trajectory: --replay <measurement point index> <experiment number>
+	if(argc == 4 && std::string(argv[1]) == "--replay")
+	{
+		replayExperiment(std::stoi(argv[2]), std::stoi(argv[3]));
+		return 0;
+	}
+	RunOptions options;
+	// Usage for continuing a run from its last checkpoint: --resume
+	options.resume = argc == 2 && std::string(argv[1]) == "--resume";
+	// Usage for a batch job of a sharded run: --shard <shard index> <number of shards>
+	if(argc == 4 && std::string(argv[1]) == "--shard")
+	{
+		options.shardIndex = std::stoi(argv[2]);
+		options.numShards  = std::stoi(argv[3]);
+		if(!isShardable() || options.shardIndex < 0 || options.numShards <= options.shardIndex || NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK < options.numShards)
+		{
+			std::cout << "Error: this configuration can not be run as shard " << options.shardIndex << " of " << options.numShards << "." << std::endl;
+			return 1;
+		}
+	}
+	// Usage for combining the shard files of a sharded run, in any order: --merge <shard files...>
+	if(3 <= argc && std::string(argv[1]) == "--merge")
+	{
+		if(!isShardable())
+		{
+			std::cout << "Error: this configuration can not be run in shards." << std::endl;
+			return 1;
+		}
+		options.mergeFileNames.assign(argv + 2, argv + argc);
+	}
+	// Usage for running experiments for bin/matrixJobClient: --serve [socket path]
+	if((argc == 2 || argc == 3) && std::string(argv[1]) == "--serve")
+	{
+		options.serverSocketPath = argc == 3 ? std::string(argv[2]) : UnixSocket::userRuntimePath(JOB_SERVER_SOCKET_NAME);
+	}
+	if(options.resume || 1 < options.numShards || !options.mergeFileNames.empty() || !options.serverSocketPath.empty()) argc = 1;
 	theApp = new TApplication("App", &argc, argv);
-	physicsMain();
+	physicsMain(options);
 	return 0;
 }
 
-void physicsMain()
+void physicsMain(const RunOptions& options)
 {
 	std::cout << "\n";
 	printPhysicsInfo();
 	std::cout << "\n";
+	WorkStealingScheduler scheduler(NUM_WORKER_THREADS, PIN_WORKER_THREADS);
+	std::cout << "Running experiments on " << scheduler.size() << " worker thread(s).\n";
+	std::cout << scheduler.getPlacement().describe();
+	if(0 < scheduler.getNumPinFailures()) std::cout << "Warning: " << scheduler.getNumPinFailures() << " worker thread(s) could not be pinned to their CPU.\n";
+	if(USE_PARAMETER_SWEEP)
+	{
+		runParameterSweep(scheduler);
+		std::cout << "\nThe program terminated succesfully (exit with Ctrl-c)." << std::endl;
+		theApp -> Run();
+		return;
+	}
+	if(USE_BEAM_BUNCHES)
+	{
+		runBeamBunches(scheduler);
+		std::cout << "\nThe program terminated succesfully (exit with Ctrl-c)." << std::endl;
+		theApp -> Run();
+		return;
+	}
+	if(!options.serverSocketPath.empty())
+	{
+		runJobServer(scheduler, options.serverSocketPath);
+		return;
+	}
+	if(1 < options.numShards)
+	{
+		runShard(scheduler, options.shardIndex, options.numShards);
+		return;
+	}
 	std::vector<std::shared_ptr<TH1D>> electronPositionsX_V;
 	TH2D electronEnergyEndPositionsX_H ("electronEnergyEndPositionsX",  "Electron end position distribution vs starting kin. energy;x pos(bohr);starting kin. energy (eV)",  
 		END_POS_NUM_BINS,                      END_POS_MIN_RANGE,                                                                  END_POS_MAX_RANGE,
@@ -160,73 +622,274 @@ void physicsMain()
 	std::vector<long long> totalNumUpdates;
 	static_assert(64 <= 8 * sizeof(long long), "WARNING: Progress sizes might not be calculated properly, since your architecture implements long long with size less than 64 bits.");
 	std::vector<int> electronsAbsorbed;
-	Pbar totalProgress;
+	std::vector<int> numExperiments;
 	auto start = time(NULL);
-	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	// Every block of every measurement point of a round is scheduled at once, so that no thread idles
+	// at the end of a measurement point. Block costs (number of updates, absorbed experiments
+	// included) are collected online to order the work and to size the chunks.
+	std::vector<MeasurementPointResult> pointResults(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS);
+	// Measurement points found in the result cache are not simulated again. Budgeted runs depend on the timing, they are neither
+	// cached nor checkpointed, like the runs without rounds of experiment blocks.
+	// Merged shard files may hold a part of the randomisations only, their results are neither cached nor checkpointed.
+	const bool merging             = !options.mergeFileNames.empty();
+	const bool deterministicRounds = RUN_TIME_BUDGET_SECONDS <= 0 && !USE_MULTILEVEL_MONTE_CARLO && !USE_SURROGATE_MAP && !USE_ENERGY_SWEEP_LANES;
+	const bool useResultCache      = USE_RESULT_CACHE && deterministicRounds && !merging;
+	const bool checkpointing       = 0 < CHECKPOINT_INTERVAL_SECONDS && deterministicRounds && !merging;
+	std::unique_ptr<ResultCache> resultCache(useResultCache ? new ResultCache(RESULT_CACHE_DIRECTORY) : nullptr);
+	std::vector<std::string> cacheKeys(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS);
+	if(useResultCache)
 	{
-		totalNumUpdates  .push_back(0);
-		electronsAbsorbed.push_back(0);
-		int errorTriggered = 0;
-		electronPositionsX_V.emplace_back(std::make_shared<TH1D>(("electronPositionsX" + std::to_string(measurementPointIndex)).c_str(),  "Electron positions X",  END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE));
-		const auto& startKineticEnergyFillPos = ELECTRON_START_KIN_ENERGIES[measurementPointIndex];
-		Pbar experimentProgress;
-		TH2D screenshots_H(("screenshots_" + std::to_string(measurementPointIndex)).c_str(),  "Electron hit positions on plane ;x pos(bohr);z pos (bohr)",  
-			SCREENSHOTS_X_BIN_NUMBER, SCREENSHOTS_X_POS_MIN_RANGE, SCREENSHOTS_X_POS_MAX_RANGE, SCREENSHOTS_Z_BIN_NUMBER, SCREENSHOTS_Z_POS_MIN_RANGE, SCREENSHOTS_Z_POS_MAX_RANGE);
-		screenshots_H.SetMarkerStyle(8);
-		screenshots_H.SetMarkerSize (SCREENSHOTS_MARKERSIZES);
-		screenshots_H.SetMarkerColor(kOrange + 1);
-		for(int experimentNumber = 0; experimentNumber < NUM_EXPERIMENTS_PER_SETUP; ++experimentNumber)
+		int numLoaded = 0;
+		for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
 		{
-			int numUpdates = 0;
-			int experimentSuccesful = 0;
-			initExperiment(measurementPointIndex);
-			vec3 electronHitPosition = runExperiment(numUpdates, experimentSuccesful);
-			clearExperiment();
-			if(!experimentSuccesful)
+			cacheKeys[measurementPointIndex] = measurementPointCacheKey(measurementPointIndex, SCATTERING_EXPERIMENT, "rounds");
+			numLoaded += isCacheable(measurementPointIndex) && loadFromResultCache(*resultCache, cacheKeys[measurementPointIndex], pointResults[measurementPointIndex]);
+		}
+		std::cout << numLoaded << " of " << ELECTRON_START_KIN_EN_NUM_MEAS_POINTS << " measurement points loaded from the result cache " << RESULT_CACHE_DIRECTORY << ".\n";
+	}
+	if(merging && !mergeShardFiles(options.mergeFileNames, pointResults)) return;
+	int firstRound = 0;
+	if(options.resume)
+	{
+		if(!checkpointing || !readCheckpoint(pointResults, firstRound))
+		{
+			std::cout << "Error: no checkpoint of this configuration in " << CHECKPOINT_FILE_NAME << "." << std::endl;
+			return;
+		}
+		std::cout << "Resuming round " << firstRound << " from " << CHECKPOINT_FILE_NAME << ".\n";
+	}
+	if(USE_CONTROL_VARIATES)
+	{
+		std::cout << "Calculating the expected hit distributions of the reduced model..." << std::endl;
+		std::vector<WorkRange> measurementPoints(1, WorkRange{0, 0, ELECTRON_START_KIN_EN_NUM_MEAS_POINTS});
+		scheduler.run(measurementPoints, [] (const int&) { return 1.0; }, [&pointResults] (const int&, const int& measurementPointIndex)
+		{
+			if(pointResults[measurementPointIndex].numCachedExperiments == 0) pointResults[measurementPointIndex].modelHitProbabilities = calculateModelHitProbabilities(measurementPointIndex);
+		}, [] (const long long&, const long long&) {});
+	}
+	std::vector<CostStatistics> blockCosts(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS);
+	auto expectedBlockCost = [&blockCosts] (const int& measurementPointIndex)
+	{
+		// Conservative estimate: points with widely varying trajectory lengths get smaller chunks
+		const CostStatistics& costs = blockCosts[measurementPointIndex];
+		return costs.getMean(NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(measurementPointIndex)) + costs.getStandardDeviation();
+	};
+	std::atomic<long long> roundNumUpdates(0);
+	auto processBlock = [&pointResults, &blockCosts, &roundNumUpdates] (const int& measurementPointIndex, const int& blockIndex)
+	{
+		MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+		// Built by the worker, so that the histograms are in the memory of its NUMA node
+		ExperimentBlockResult blockResult;
+		long long blockCost = runExperimentBlock(measurementPointIndex, blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, pointResult.absorptionMap, blockResult);
+		blockCosts[measurementPointIndex].add(blockCost);
+		roundNumUpdates += blockCost;
+		std::unique_lock<std::mutex> lock(checkpointMutex);
+		blockResult.finished = 1;
+		pointResult.blockResults[blockIndex] = std::move(blockResult);
+	};
+	const bool budgeted = 0 < RUN_TIME_BUDGET_SECONDS;
+	void (*previousInterruptHandler)(int) = budgeted ? std::signal(SIGINT, requestStop) : SIG_DFL;
+	const auto runStart = std::chrono::steady_clock::now();
+	double updatesPerSecond = 0.0;
+	// Multilevel Monte Carlo and the surrogate maps replace the rounds of experiments
+	std::vector<HistogramAccumulator> pointEstimates;
+	if(USE_MULTILEVEL_MONTE_CARLO) pointEstimates = runMultilevelMonteCarlo(scheduler);
+	else if(USE_SURROGATE_MAP)     pointEstimates = runSurrogateMaps(scheduler);
+	if(USE_ENERGY_SWEEP_LANES && pointEstimates.empty())
+	{
+		// A single round: every block holds the same experiments at all energies
+		for(auto& pointResult: pointResults) pointResult.blockResults.resize(NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK);
+		std::vector<WorkRange> blockRange(1, WorkRange{0, 0, NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK});
+		Pbar sweepProgress;
+		int percentPrinted = 0;
+		scheduler.run(blockRange, [] (const int&)
+		{
+			double cost = 0.0;
+			for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex) cost += NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(measurementPointIndex);
+			return cost;
+		}, [&pointResults] (const int&, const int& blockIndex)
+		{
+			std::vector<ExperimentBlockResult>  blockResults(pointResults.size()); // in the memory of the worker's NUMA node
+			std::vector<ExperimentBlockResult*> results;
+			for(auto& blockResult: blockResults) results.push_back(&blockResult);
+			runEnergySweepBlock(blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, results);
+			for(unsigned int measurementPointIndex = 0; measurementPointIndex < pointResults.size(); ++measurementPointIndex)
 			{
-				electronsAbsorbed.back()++;
-				if(!errorTriggered && NUM_EXPERIMENTS_PER_SETUP / 2 < electronsAbsorbed.back())
-				{
-					errorTriggered = 1;
-					std::cout << "Warning: more than half of the electrons were already absorbed in this configuration." << std::endl;
-				}
-				experimentNumber -= 1;
-				continue;
+				pointResults[measurementPointIndex].blockResults[blockIndex] = std::move(blockResults[measurementPointIndex]);
+			}
+		}, [&sweepProgress, &percentPrinted] (const long long& numBlocksDone, const long long& numBlocksTotal)
+		{
+			const int percentDone = numBlocksDone * 100 / numBlocksTotal;
+			if(percentPrinted < percentDone)
+			{
+				sweepProgress.update(percentDone - percentPrinted);
+				percentPrinted = percentDone;
+			}
+			sweepProgress.print();
+		});
+		for(auto& pointResult: pointResults)
+		{
+			mergeNewBlockResults(pointResult);
+			pointResult.relativePrecision = calculateRelativePrecision(estimateHistogram(pointResult));
+			pointResult.converged = 1;
+		}
+	}
+	for(int round = firstRound; pointEstimates.empty() && !USE_ENERGY_SWEEP_LANES; ++round)
+	{
+		// The first round is a pilot with NUM_EXPERIMENTS_PER_SETUP (ABSORPTION_PILOT_EXPERIMENTS with the absorption
+		// predictor) experiments everywhere, budgeted runs then share the time of each round by the measured variances and costs
+		const double secondsLeft = RUN_TIME_BUDGET_SECONDS - std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+		if(budgeted && 0 < round && (secondsLeft <= 0 || stopRequested)) break;
+		std::vector<int> roundExperiments(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, 0);
+		if(budgeted && 0 < round)
+		{
+			roundExperiments = allocateBudgetRound(pointResults, blockCosts, updatesPerSecond * std::min<double>(BUDGET_ROUND_SECONDS, secondsLeft));
+		}
+		else
+		{
+			for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+			{
+				if(!pointResults[measurementPointIndex].converged) roundExperiments[measurementPointIndex] = numExperimentsInNextRound(pointResults[measurementPointIndex]);
 			}
-			if(measurementPointIndex == 0 && SAVE_2D_SCREENSHOTS)
+		}
+		// A round resumed from a checkpoint has its blocks already, only the unfinished ones are scheduled
+		std::vector<WorkRange> blockRanges;
+		std::vector<int> roundPoints;
+		for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+		{
+			MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+			const bool resumedRound = pointResult.numBlocksMerged < static_cast<int>(pointResult.blockResults.size());
+			if(!resumedRound && (pointResult.converged || roundExperiments[measurementPointIndex] == 0)) continue;
+			if(!resumedRound) pointResult.blockResults.resize(pointResult.blockResults.size() + roundExperiments[measurementPointIndex] / NUM_EXPERIMENTS_PER_BLOCK);
+			roundPoints.push_back(measurementPointIndex);
+			for(int blockIndex = pointResult.numBlocksMerged; blockIndex < static_cast<int>(pointResult.blockResults.size()); ++blockIndex)
 			{
-				screenshots_H.Fill(electronHitPosition.x, electronHitPosition.z);
-				if(experimentNumber == 900)
-				{
-					gROOT -> SetBatch(kTRUE);
-					TCanvas screenshotsCanvas;
-					screenshotsCanvas.cd();
-					screenshots_H.Draw();
-					gErrorIgnoreLevel = kWarning;
-					screenshotsCanvas.Print(("screenshots_2/" + std::to_string(experimentNumber + 1) + ".eps").c_str());
-					gROOT -> SetBatch(kFALSE);
-				}
+				if(pointResult.blockResults[blockIndex].finished) continue;
+				if(!blockRanges.empty() && blockRanges.back().group == measurementPointIndex && blockRanges.back().end == blockIndex) blockRanges.back().end++;
+				else blockRanges.push_back(WorkRange{measurementPointIndex, blockIndex, blockIndex + 1});
+			}
+		}
+		if(roundPoints.empty()) break;
+		if(ADAPTIVE_STOPPING || budgeted) std::cout << "\nRound " << round << ":\n";
+		roundNumUpdates = 0;
+		const auto roundStart = std::chrono::steady_clock::now();
+		Pbar roundProgress;
+		int percentPrinted = 0;
+		auto printProgress = [&roundProgress, &percentPrinted] (const long long& numBlocksDone, const long long& numBlocksTotal)
+		{
+			const int percentDone = numBlocksDone * 100 / numBlocksTotal;
+			if(percentPrinted < percentDone)
+			{
+				roundProgress.update(percentDone - percentPrinted);
+				percentPrinted = percentDone;
+			}
+			roundProgress.print();
+		};
+		{
+			// The checkpoints of a round are written by a thread of their own while the workers run
+			std::unique_ptr<PeriodicTask> checkpointTask(checkpointing ? new PeriodicTask(CHECKPOINT_INTERVAL_SECONDS, [&pointResults, round] { writeCheckpoint(pointResults, round); }) : nullptr);
+			if(!blockRanges.empty()) scheduler.run(blockRanges, expectedBlockCost, processBlock, printProgress);
+		}
+		updatesPerSecond = roundNumUpdates / std::max(1e-3, std::chrono::duration<double>(std::chrono::steady_clock::now() - roundStart).count());
+		for(const auto& measurementPointIndex: roundPoints)
+		{
+			MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+			mergeNewBlockResults(pointResult);
+			if(USE_ABSORPTION_PREDICTOR) pointResult.absorptionMap.updatePrediction();
+			pointResult.relativePrecision = calculateRelativePrecision(estimateHistogram(pointResult));
+			pointResult.converged = (!ADAPTIVE_STOPPING && !budgeted && NUM_EXPERIMENTS_PER_SETUP <= pointResult.getNumExperiments()) || (ADAPTIVE_STOPPING && pointResult.relativePrecision <= TARGET_RELATIVE_PRECISION) || MAX_EXPERIMENTS_PER_SETUP <= pointResult.getNumExperiments();
+			if(ADAPTIVE_STOPPING || budgeted)
+			{
+				std::cout << "\nMeasurement point " << measurementPointIndex << ": " << pointResult.getNumExperiments() << " experiments, relative precision " << pointResult.relativePrecision
+					<< (pointResult.converged ? (pointResult.relativePrecision <= TARGET_RELATIVE_PRECISION ? ", converged." : ", stopped at the experiment limit.") : ".") << std::flush;
 			}
-			if(experimentNumber % (NUM_EXPERIMENTS_PER_SETUP / 100) == 0)
+		}
+		if(budgeted) writeMatrixSnapshot(pointResults);
+		if(checkpointing) writeCheckpoint(pointResults, round + 1);
+	}
+	if(budgeted)
+	{
+		std::signal(SIGINT, previousInterruptHandler);
+		if(stopRequested) std::cout << "\nStopped on request, the results of the finished rounds are kept." << std::endl;
+	}
+	for(int measurementPointIndex = 0; useResultCache && measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		if(isCacheable(measurementPointIndex) && pointResults[measurementPointIndex].numCachedExperiments == 0) storeInResultCache(*resultCache, cacheKeys[measurementPointIndex], pointResults[measurementPointIndex]);
+	}
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		const MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+		totalNumUpdates  .push_back(pointResult.totalNumUpdates);
+		electronsAbsorbed.push_back(pointResult.electronsAbsorbed);
+		numExperiments   .push_back(pointResult.getNumExperiments());
+		electronPositionsX_V.emplace_back(std::make_shared<TH1D>(("electronPositionsX" + std::to_string(measurementPointIndex)).c_str(),  "Electron positions X",  END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE));
+		if(measurementPointIndex == 0 && SAVE_2D_SCREENSHOTS && pointEstimates.empty())
+		{
+			TH2D screenshots_H(("screenshots_" + std::to_string(measurementPointIndex)).c_str(),  "Electron hit positions on plane ;x pos(bohr);z pos (bohr)",  
+				SCREENSHOTS_X_BIN_NUMBER, SCREENSHOTS_X_POS_MIN_RANGE, SCREENSHOTS_X_POS_MAX_RANGE, SCREENSHOTS_Z_BIN_NUMBER, SCREENSHOTS_Z_POS_MIN_RANGE, SCREENSHOTS_Z_POS_MAX_RANGE);
+			screenshots_H.SetMarkerStyle(8);
+			screenshots_H.SetMarkerSize (SCREENSHOTS_MARKERSIZES);
+			screenshots_H.SetMarkerColor(kOrange + 1);
+			int numScreenshotHits = 0;
+			for(const auto& blockResult: pointResult.blockResults)
 			{
-				totalProgress.update(1.0f / ELECTRON_START_KIN_EN_NUM_MEAS_POINTS);
-				experimentProgress.update(1);
-				totalProgress.print();
-				experimentProgress.printNoUpdate();
-			// 	std::cout << experimentNumber * 100.0f / NUM_EXPERIMENTS << '%' << std::endl;
+				for(unsigned int hitIndex = 0; hitIndex < blockResult.screenshotHits.size(); ++hitIndex)
+				{
+					const auto& hitPosition = blockResult.screenshotHits[hitIndex];
+					// Mirror images of the hit for the parts of the start range that were not sampled
+					const int numImages = (1 + START_SYMMETRIES.mirrorX) * (1 + START_SYMMETRIES.mirrorZ);
+					for(int xSign = 1; -1 <= xSign; xSign -= 2)
+					{
+						for(int zSign = 1; -1 <= zSign; zSign -= 2)
+						{
+							if((xSign < 0 && !START_SYMMETRIES.mirrorX) || (zSign < 0 && !START_SYMMETRIES.mirrorZ)) continue;
+							screenshots_H.Fill(xSign * hitPosition.first, zSign * hitPosition.second, blockResult.screenshotWeights[hitIndex] / numImages);
+						}
+					}
+					if(numScreenshotHits++ == 900)
+					{
+						gROOT -> SetBatch(kTRUE);
+						TCanvas screenshotsCanvas;
+						screenshotsCanvas.cd();
+						screenshots_H.Draw();
+						gErrorIgnoreLevel = kWarning;
+						screenshotsCanvas.Print(("screenshots_2/" + std::to_string(numScreenshotHits) + ".eps").c_str());
+						gROOT -> SetBatch(kFALSE);
+					}
+				}
 			}
-			// std::cout << "Filling at: " << electronHitPosition.x << ", " << startKineticEnergyFillPos << std::endl; std::cin.get();
-			electronPositionsX_V.back() -> Fill(electronHitPosition.x);
-			electronEnergyEndPositionsX_H.Fill(electronHitPosition.x, startKineticEnergyFillPos);
-			totalNumUpdates.back() += numUpdates;
 		}
+		if(pointResult.getNumExperiments() / 2 < pointResult.electronsAbsorbed)
+		{
+			std::cout << "\nWarning: more than half of the electrons were absorbed in measurement point " << measurementPointIndex << "." << std::endl;
+		}
+		if(USE_ABSORPTION_PREDICTOR && pointEstimates.empty() && pointResult.numCachedExperiments == 0)
+		{
+			std::cout << "\nMeasurement point " << measurementPointIndex << ": absorbed fraction of the start conditions " << pointResult.absorptionMap.estimateAbsorbedFraction()
+				<< " (absorption map), " << pointResult.absorptionMap.getPredictedAbsorbingVolume() << " predicted to absorb, " << pointResult.startsRejected << " experiments ended without integration." << std::flush;
+		}
+		HistogramAccumulator electronPositionsX = pointEstimates.empty() ? estimateHistogram(pointResult) : pointEstimates[measurementPointIndex];
+		const int numPointExperiments = pointEstimates.empty() ? pointResult.getNumExperiments() : NUM_EXPERIMENTS_PER_SETUP;
+		// The multilevel estimates do not come from replicates, the bin errors of the surrogate maps are no statistical errors
+		// to derive confidence intervals from (see runSurrogateMaps)
+		if(pointEstimates.empty() || USE_MULTILEVEL_MONTE_CARLO) printConfidenceIntervalSummary(measurementPointIndex, electronPositionsX, pointEstimates.empty() ? pointResult.electronPositionsXReplicates.size() : 0);
+		if(USE_CONTROL_VARIATES && pointEstimates.empty())
+		{
+			std::cout << "\nMeasurement point " << measurementPointIndex << ": relative precision " << calculateRelativePrecision(sumWithReplicateErrors(unfoldSymmetries(pointResult.electronPositionsXReplicates)))
+				<< " without, " << pointResult.relativePrecision << " with the reduced model control variates." << std::flush;
+		}
+		// The energy axis has one bin per measurement point
+		copyToMatrixRow(electronPositionsX, numPointExperiments, electronEnergyEndPositionsX_H, measurementPointIndex);
+		// Per NUM_EXPERIMENTS_PER_SETUP experiments like the matrix rows (e.g. of a partial merge of shards)
+		electronPositionsX.scale(NUM_EXPERIMENTS_PER_SETUP / static_cast<double>(numPointExperiments));
+		electronPositionsX.copyToHistogram(*electronPositionsX_V.back());
 	}
 	std::cout << "\n\n";
 	auto end = time(NULL);
 	std::cout << "Took about: " << end - start << " second(s)." << std::endl;
 	std::cout << "Average number of updates per experiment: \n";
 	for(auto i: range(totalNumUpdates.size()))
-		std::cout << "\t" << std::resetiosflags(std::ios::fixed) << std::setw(8) << totalNumUpdates[i] / static_cast<double>(NUM_EXPERIMENTS_PER_SETUP) << " with " << std::setw(5) << electronsAbsorbed[i] << " experiment fails because of electron absorbtion" << std::endl;
+		if(0 < numExperiments[i]) std::cout << "\t" << std::resetiosflags(std::ios::fixed) << std::setw(8) << totalNumUpdates[i] / static_cast<double>(numExperiments[i]) << " with " << std::setw(5) << electronsAbsorbed[i] << " experiment fails because of electron absorbtion" << std::endl;
 	if(SAVE_POSITION_DISTRIBUTIONS)
 	{
 		TCanvas canvas;
@@ -244,52 +907,99 @@ void physicsMain()
 		}
 		gROOT -> SetBatch(kFALSE);
 	}
+	if(USE_DETECTOR_STAGE && pointEstimates.empty() && !USE_ENERGY_SWEEP_LANES) writeDetectorObservables(pointResults);
 	std::cout << "\nThe program terminated succesfully (exit with Ctrl-c)." << std::endl;
 	theApp -> Run();
 }
 
-void setProtonPositions()
+// With common random numbers every measurement point draws the start conditions of measurement point 0
+int randomStreamSetup(const int& numSetup)
+{
+	return USE_ENERGY_SWEEP_LANES ? 0 : numSetup;
+}
+
+// Every experiment has its own random number stream, keyed on the run seed,
+// the measurement point and the experiment number. Retries of absorbed experiments
+// continue the same stream, so any experiment can be replayed by its index alone.
+PhiloxRandom createExperimentRandomGenerator(const int& numSetup, const int& experimentNumber)
+{
+	return PhiloxRandom(RANDOM_SEED, randomStreamSetup(numSetup), experimentNumber);
+}
+
+// Uniform [0, 1) numbers for the start conditions (x position, z velocity) of an attempt of an experiment.
+// With quasi-Monte Carlo the first attempt uses the experiment's point of the scrambled Sobol sequence
+// of its randomisation, retries after absorption fall back to the experiment's pseudo-random stream.
+// The second experiment of an antithetic pair uses the numbers of the first one on its first attempt.
+void drawStartConditionSamples(const int& numSetup, const int& experimentNumber, const int& attempt, PhiloxRandom& randomGenerator, double* uniformSamples)
+{
+	const int slot = experimentNumber % NUM_EXPERIMENTS_PER_RANDOMISATION;
+	const int sourceExperimentNumber = experimentNumber - slot + IMPACT_PARAMETER_SAMPLER.randomNumberSourceSlot(slot);
+	if(attempt == 0 && sourceExperimentNumber != experimentNumber)
+	{
+		PhiloxRandom sourceRandomGenerator = createExperimentRandomGenerator(numSetup, sourceExperimentNumber);
+		drawStartConditionSamples(numSetup, sourceExperimentNumber, 0, sourceRandomGenerator, uniformSamples);
+		return;
+	}
+	if(USE_QUASI_MONTE_CARLO && attempt == 0)
+	{
+		const int randomisation = experimentNumber / NUM_EXPERIMENTS_PER_RANDOMISATION;
+		// The randomisation seeds are taken from streams flagged by the highest bit, apart from the experiment streams
+		PhiloxRandom::Block seedBlock = PhiloxRandom(RANDOM_SEED, 0x80000000u | randomStreamSetup(numSetup), randomisation).generateBlock(0);
+		SobolSequence sobolSequence((static_cast<std::uint64_t>(seedBlock[1]) << 32) | seedBlock[0]);
+		sobolSequence.fillSample(experimentNumber % NUM_EXPERIMENTS_PER_RANDOMISATION, uniformSamples, 2);
+		return;
+	}
+	randomGenerator.fillUniform(uniformSamples, 2);
+}
+
+// Stratification, antithetic pairs and importance sampling of the start x are done by IMPACT_PARAMETER_SAMPLER.
+// Retries after absorption are drawn uniformly from the whole start range and keep the weight of the first
+// attempt (see ImpactParameterSampler::retry), redrawing them in the stratum of the first attempt would bias
+// the hit distribution wherever the absorption differs between the strata.
+// Only the fundamental domain of START_SYMMETRIES is sampled: x >= 0 and vz >= 0 when mirror symmetric.
+StartConditions drawStartConditions(const int& numSetup, const int& experimentNumber, const int& attempt, PhiloxRandom& randomGenerator)
 {
-	for(int protonIndex = 0; protonIndex < NUMBER_OF_PROTONS; ++protonIndex)
+	double uniformSamples[2];
+	drawStartConditionSamples(numSetup, experimentNumber, attempt, randomGenerator, uniformSamples);
+	ImpactParameterSampler::Sample impactParameter;
+	if(attempt == 0) impactParameter = IMPACT_PARAMETER_SAMPLER.sample(uniformSamples[0], experimentNumber % NUM_EXPERIMENTS_PER_RANDOMISATION);
+	else
 	{
-		const auto& proton = ChargedParticle::chargedParticleCollection[protonIndex];
-		proton -> setPosition(vec3(PROTONPOSITIONS[protonIndex], 0, 0));
+		PhiloxRandom firstAttemptRandomGenerator = createExperimentRandomGenerator(numSetup, experimentNumber);
+		impactParameter = IMPACT_PARAMETER_SAMPLER.retry(uniformSamples[0], drawStartConditions(numSetup, experimentNumber, 0, firstAttemptRandomGenerator).weight);
 	}
+	const double zVelocitySample = START_SYMMETRIES.mirrorZ ? 0.5 + 0.5 * uniformSamples[1] : uniformSamples[1];
+	return StartConditions{static_cast<float>(impactParameter.x), static_cast<float>(zVelocitySample), impactParameter.weight};
 }
 
-// Electron x position: between two protons in the middle
-void setElectronStartPositionVelocity(const int& numSetup)
+// Beam source of the experiments
+void electronStartPositionVelocity(const int& numSetup, const StartConditions& startConditions, vec3& position, vec3& velocity)
 {
-	auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
 	float x, y, z;
 	float vx, vy, vz;
 	// Example for 6 protons:
 	// -2.5  -1.5  -0.5   0.5   1.5   2.5
 	//   p     p     p*****p     p     p
 	// Calc: -0.5 + uniform_rand(0, 1)
-	x = rand() / static_cast<double>(RAND_MAX) * (ELECTRON_START_X_POS_MAX - ELECTRON_START_X_POS_MIN) - ELECTRON_START_X_POS_MAX;
+	x = startConditions.x;
 	y = ELECTRON_START_PLANE_DISTANCE;
 	z = 0.0f;
 	vx = 0.0f;
 	vy = -ELECTRON_START_VELOCITIES[numSetup];
-    if(SAVE_2D_SCREENSHOTS) vz = rand() / static_cast<double>(RAND_MAX) * (ELECTRON_START_Z_POS_MAX - ELECTRON_START_Z_POS_MIN) + ELECTRON_START_Z_POS_MIN;
+    if(SAVE_2D_SCREENSHOTS) vz = startConditions.zVelocitySample * (ELECTRON_START_Z_POS_MAX - ELECTRON_START_Z_POS_MIN) + ELECTRON_START_Z_POS_MIN;
     else                    vz = 0.0f;
-	electron -> setPosition(vec3( x,  y,  z));
-	electron -> setVelocity(vec3(vx, vy, vz));
+	position = vec3( x,  y,  z);
+	velocity = vec3(vx, vy, vz);
 }
 
 // Initialize an experiment setup:
-// Two fixed protons and one electron moving towards them 
-// with randomized velocity and position
-void initExperiment(const int& numSetup)
+// The fixed protons and one electron moving towards them with the given start conditions.
+// The particles of a thread are kept between the experiments, see ScatteringExperiment::init().
+void initExperiment(const int& numSetup, const StartConditions& startConditions, const ScatteringExperiment& experiment)
 {
-	for(int protonIndex = 0; protonIndex < NUMBER_OF_PROTONS; ++protonIndex)
-	{
-		new Proton();
-	}
-	new Electron();
-	setProtonPositions();
-	setElectronStartPositionVelocity(numSetup);
+	vec3 position, velocity;
+	electronStartPositionVelocity(numSetup, startConditions, position, velocity);
+	experiment.init(position, velocity);
 }
 
 void drawSampleElectronPaths(const int& numPaths)
@@ -300,41 +1010,30 @@ void drawSampleElectronPaths(const int& numPaths)
 	TH2D proton_positons_H("b",  "",  
 		2000, END_POS_MIN_RANGE, END_POS_MAX_RANGE,
 		2000, -ELECTRON_END_PLANE_DISTANCE, ELECTRON_START_PLANE_DISTANCE);
-	for(const auto& protonPosition: PROTONPOSITIONS)
+	for(int chargeIndex = 0; chargeIndex < TARGET.getNumCharges(); ++chargeIndex)
 	{
-		proton_positons_H.Fill(protonPosition, 0);
+		proton_positons_H.Fill(TARGET.getPositions()[chargeIndex].x, TARGET.getPositions()[chargeIndex].y);
 	}
-	int numUpdates = 0;
 	for(int pathIndex = 0; pathIndex < numPaths; pathIndex++)
 	{
-		initExperiment(0);
-		while(1)
+		PhiloxRandom randomGenerator = createExperimentRandomGenerator(0, pathIndex);
+		initExperiment(0, drawStartConditions(0, pathIndex, 0, randomGenerator));
+		BoundStateClassifier absorptionClassifier = createAbsorptionClassifier();
+		auto terminate = [&absorptionClassifier] (const ChargedParticle& electron, const int&)
 		{
-			numUpdates++;
-			auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
-			electron -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-			electron -> update(DT_STEP);
-			const vec3& electronPosition = electron -> getPosition();
-			if(electronPosition.y < -ELECTRON_END_PLANE_DISTANCE)
-			{
-				break;
-			}
-			if(NUM_UPDATES_BEFORE_ABSORBTION_TESTING <= numUpdates)
-			{
-				// Check if the electron is absorbed
-				if(numUpdates % NUM_ITERATIONS_BETWEEN_ABS_TESTS == 0)
-				{
-					if(electron -> calculatePotentialEnergy() + electron -> calculateKineticEnergy() < 0)
-					{
-						std::cout << "Warning: one of the sample electron paths has an absorbed electron." << std::endl;
-						break;
-					}
-				}
-			}
-			sampleElectron_path_H.Fill(electronPosition.x, electronPosition.y);
+			if(electron.getPosition().y < -ELECTRON_END_PLANE_DISTANCE) return ScatteringExperiment::HIT;
+			return absorptionClassifier.update(electron) ? ScatteringExperiment::ABSORBED : ScatteringExperiment::RUNNING;
+		};
+		auto fillPath = [&sampleElectron_path_H] (const ChargedParticle& electron, const vec3&, const vec3&, const int&)
+		{
+			sampleElectron_path_H.Fill(electron.getPosition().x, electron.getPosition().y);
+		};
+		if(SCATTERING_EXPERIMENT.run(DT_STEP, terminate, fillPath).outcome == ScatteringExperiment::ABSORBED)
+		{
+			std::cout << "Warning: one of the sample electron paths has an absorbed electron." << std::endl;
 		}
-		clearExperiment();
 	}
+	clearExperiment();
 	proton_positons_H.SetMarkerStyle(8);
 	proton_positons_H.SetMarkerSize (1.5);
 	proton_positons_H.SetMarkerColor(kRed);
@@ -347,43 +1046,1599 @@ void drawSampleElectronPaths(const int& numPaths)
 	std::cin.get();
 }
 
-// Contains calculations for the scattering processes
-const vec3 runExperiment(int& numUpdates, int& experimentSuccesful)
+// Straight line flight time from the start plane to the end plane in number of updates,
+// used as the cost estimate of a measurement point before any experiments are done
+double expectedNumUpdatesPerExperiment(const int& numSetup)
 {
-	numUpdates = 0;
-	while(1)
+	return (ELECTRON_START_PLANE_DISTANCE + ELECTRON_END_PLANE_DISTANCE) / (ELECTRON_START_VELOCITIES[numSetup] * DT_STEP);
+}
+
+// Adds the blocks finished since the last merge to the replicates and counters of the measurement point
+void mergeNewBlockResults(MeasurementPointResult& pointResult)
+{
+	const int numReplicates = pointResult.getNumExperiments() / NUM_EXPERIMENTS_PER_RANDOMISATION;
+	pointResult.electronPositionsXReplicates.resize(numReplicates, HistogramAccumulator(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE));
+	pointResult.modelControlReplicates   .resize(numReplicates, ControlVariateAccumulator(USE_CONTROL_VARIATES ? END_POS_NUM_BINS : 0, END_POS_MIN_RANGE, END_POS_MAX_RANGE));
+	for(; pointResult.numBlocksMerged < static_cast<int>(pointResult.blockResults.size()); ++pointResult.numBlocksMerged)
+	{
+		const int blockIndex = pointResult.numBlocksMerged;
+		auto& blockResult = pointResult.blockResults[blockIndex];
+		pointResult.electronPositionsXReplicates[blockIndex * NUM_EXPERIMENTS_PER_BLOCK / NUM_EXPERIMENTS_PER_RANDOMISATION].add(blockResult.electronPositionsX);
+		pointResult.modelControlReplicates   [blockIndex * NUM_EXPERIMENTS_PER_BLOCK / NUM_EXPERIMENTS_PER_RANDOMISATION].add(blockResult.modelControl);
+		pointResult.totalNumUpdates   += blockResult.totalNumUpdates;
+		pointResult.electronsAbsorbed += blockResult.electronsAbsorbed;
+		pointResult.startsRejected    += blockResult.startsRejected;
+		for(unsigned int observableIndex = 0; observableIndex < blockResult.observableHistograms.size(); ++observableIndex)
+		{
+			pointResult.observableHistograms[observableIndex].add(blockResult.observableHistograms[observableIndex]);
+		}
+		pointResult.absorptionMap.record(blockResult.absorptionAttempts);
+		std::vector<AbsorptionMap::Attempt>().swap(blockResult.absorptionAttempts);
+	}
+}
+
+// Sum of the replicates with errors from their spread, corrected by the reduced model control variates if enabled
+HistogramAccumulator estimateHistogram(const MeasurementPointResult& pointResult)
+{
+	if(!USE_CONTROL_VARIATES) return sumWithReplicateErrors(unfoldSymmetries(pointResult.electronPositionsXReplicates));
+	return sumWithReplicateErrors(unfoldSymmetries(applyControlVariate(pointResult.electronPositionsXReplicates, pointResult.modelControlReplicates, pointResult.modelHitProbabilities, NUM_EXPERIMENTS_PER_RANDOMISATION)));
+}
+
+// Hit distribution of the full start range from the one of the fundamental domain: with the x mirror symmetry
+// the hits of x and -x are mirror images. The z mirror symmetry leaves the x distribution unchanged.
+HistogramAccumulator unfoldSymmetries(const HistogramAccumulator& electronPositionsX, const std::vector<double>& mirrorCovariances)
+{
+	return START_SYMMETRIES.mirrorX ? mirrorSymmetrized(electronPositionsX, mirrorCovariances) : electronPositionsX;
+}
+
+// Unfolded replicates, their spread gives the errors of the unfolded histogram
+std::vector<HistogramAccumulator> unfoldSymmetries(std::vector<HistogramAccumulator> electronPositionsXReplicates)
+{
+	for(auto& replicate: electronPositionsXReplicates) replicate = unfoldSymmetries(replicate);
+	return electronPositionsXReplicates;
+}
+
+// Hit position predicted by a reduced model of the trajectory, used as control variate of the hit histogram.
+// With the 1 / d force of ChargedParticle the proton line is a long range logarithmic potential, so independent
+// small angle deflections on straight lines are far off. Instead the x motion is integrated with the height y
+// as the independent variable (midpoint steps, uniform in asinh(y / CONTROL_VARIATE_Y_STEP_SCALE)), taking the
+// y speed from energy conservation. The model has no z motion (the target charges are projected onto the z = 0 plane)
+// and no absorption; it only has to be cheap and
+// correlated with the full integration, the control variate estimate is unbiased either way.
+double reducedModelHitX(const int& numSetup, const double& startX)
+{
+	const double startVelocitySquared = ELECTRON_START_VELOCITIES[numSetup] * ELECTRON_START_VELOCITIES[numSetup];
+	auto potentialEnergy = [] (const double& x, const double& y)
 	{
-		numUpdates++;
-		auto& electron = ChargedParticle::chargedParticleCollection[NUMBER_OF_PROTONS];
-		electron -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-		electron -> update(DT_STEP);
-		const vec3& electronPosition = electron -> getPosition();
-		if(electronPosition.y < -ELECTRON_END_PLANE_DISTANCE)
+		double energy = 0.0;
+		for(int chargeIndex = 0; chargeIndex < TARGET.getNumCharges(); ++chargeIndex)
 		{
-			experimentSuccesful = 1; // No errors
-			return electronPosition;
+			const vec3& chargePosition = TARGET.getPositions()[chargeIndex];
+			energy += 0.5 * TARGET.getCharges()[chargeIndex] * std::log((x - chargePosition.x) * (x - chargePosition.x) + (y - chargePosition.y) * (y - chargePosition.y) + 1e-8);
 		}
-		if(NUM_UPDATES_BEFORE_ABSORBTION_TESTING <= numUpdates)
+		return energy;
+	};
+	const double startPotentialEnergy = potentialEnergy(startX, ELECTRON_START_PLANE_DISTANCE);
+	// d(x, vx) / d(-y)
+	auto derivatives = [&] (const double& x, const double& vx, const double& y, double& dx, double& dvx)
+	{
+		double ax = 0.0;
+		for(int chargeIndex = 0; chargeIndex < TARGET.getNumCharges(); ++chargeIndex)
 		{
-			// Check if the electron is absorbed
-			if(numUpdates % NUM_ITERATIONS_BETWEEN_ABS_TESTS == 0)
-			{
-				if(electron -> calculatePotentialEnergy() + electron -> calculateKineticEnergy() < 0)
-				{
-					// std::cout << "Electron kin. energy: " << electron -> calculateKineticEnergy()   << std::endl;
-					// std::cout << "Electron pot. energy: " << electron -> calculatePotentialEnergy() << std::endl;
-					experimentSuccesful = 0; // When the experiment is not succesful: repeat it with different starting conditions
-					return electronPosition;
-					// std::cout << "Electron absorbed: " << electronPosition.x << ", " << electronPosition.y << ", " << electronPosition.z << std::endl;
-				}
-			}
+			const vec3& chargePosition = TARGET.getPositions()[chargeIndex];
+			ax += TARGET.getCharges()[chargeIndex] * (chargePosition.x - x) / ((chargePosition.x - x) * (chargePosition.x - x) + (y - chargePosition.y) * (y - chargePosition.y) + 1e-8);
 		}
+		const double vy = std::sqrt(std::max(1e-6, startVelocitySquared - 2.0 * (potentialEnergy(x, y) - startPotentialEnergy) - vx * vx));
+		dx  = vx / vy;
+		dvx = ax / vy;
+	};
+	const double uStart = std::asinh( ELECTRON_START_PLANE_DISTANCE / CONTROL_VARIATE_Y_STEP_SCALE);
+	const double uEnd   = std::asinh(-ELECTRON_END_PLANE_DISTANCE   / CONTROL_VARIATE_Y_STEP_SCALE);
+	double x  = startX;
+	double vx = 0.0;
+	double y  = ELECTRON_START_PLANE_DISTANCE;
+	for(int step = 1; step <= CONTROL_VARIATE_NUM_Y_STEPS; ++step)
+	{
+		const double nextY = CONTROL_VARIATE_Y_STEP_SCALE * std::sinh(uStart + (uEnd - uStart) * step / CONTROL_VARIATE_NUM_Y_STEPS);
+		const double dy    = y - nextY;
+		double dx, dvx, dxMid, dvxMid;
+		derivatives(x, vx, y, dx, dvx);
+		derivatives(x + 0.5 * dy * dx, vx + 0.5 * dy * dvx, y - 0.5 * dy, dxMid, dvxMid);
+		x  += dy * dxMid;
+		vx += dy * dvxMid;
+		y   = nextY;
 	}
+	return x;
 }
 
-// Deletes particles in the experiment
-void clearExperiment()
+// Bin probabilities of the reduced model hit position for a uniform start x of the sampled domain (midpoint quadrature).
+// The weights of the start conditions make this the expectation of the control histogram of an experiment: the control
+// is filled from the first attempt of every experiment, whose start conditions follow the sampling distribution whatever
+// the absorption of the retries.
+std::vector<double> calculateModelHitProbabilities(const int& numSetup)
+{
+	HistogramAccumulator modelHits(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+	const double startXStep = (ELECTRON_START_X_POS_MAX - ELECTRON_START_X_SAMPLING_MIN) / static_cast<double>(CONTROL_VARIATE_QUADRATURE_POINTS);
+	for(int pointIndex = 0; pointIndex < CONTROL_VARIATE_QUADRATURE_POINTS; ++pointIndex)
+	{
+		modelHits.fill(reducedModelHitX(numSetup, ELECTRON_START_X_SAMPLING_MIN + (pointIndex + 0.5) * startXStep), 1.0 / CONTROL_VARIATE_QUADRATURE_POINTS);
+	}
+	std::vector<double> probabilities;
+	for(int bin = 0; bin < END_POS_NUM_BINS + 2; ++bin) probabilities.push_back(modelHits.getBinContent(bin));
+	return probabilities;
+}
+
+// Largest relative error of the bins holding at least CONVERGENCE_MIN_BIN_FRACTION of the hits
+double calculateRelativePrecision(const HistogramAccumulator& electronPositionsX)
+{
+	double totalContent = 0.0;
+	for(int bin = 1; bin <= electronPositionsX.getNumBins(); ++bin) totalContent += electronPositionsX.getBinContent(bin);
+	// Without a bin to measure it, the precision is unknown: infinite, so that such a point never counts as converged
+	double relativePrecision = std::numeric_limits<double>::infinity();
+	for(int bin = 1; bin <= electronPositionsX.getNumBins(); ++bin)
+	{
+		const double content = electronPositionsX.getBinContent(bin);
+		if(content <= 0.0 || content < CONVERGENCE_MIN_BIN_FRACTION * totalContent) continue;
+		const double binPrecision = electronPositionsX.getBinError(bin) / content;
+		relativePrecision = std::isinf(relativePrecision) ? binPrecision : std::max(relativePrecision, binPrecision);
+	}
+	return relativePrecision;
+}
+
+// The first round has NUM_EXPERIMENTS_PER_SETUP experiments, or ABSORPTION_PILOT_EXPERIMENTS with the absorption
+// predictor (without adaptive stopping the rest follows in a second round). Later rounds aim at the number of
+// experiments needed for the target precision assuming 1 / sqrt(N) scaling (twice the experiments done while the
+// precision is unknown), at least one randomisation and at most up to MAX_EXPERIMENTS_PER_SETUP.
+int numExperimentsInNextRound(const MeasurementPointResult& pointResult)
+{
+	const int numDone = pointResult.getNumExperiments();
+	if(numDone == 0) return USE_ABSORPTION_PREDICTOR ? std::min(ABSORPTION_PILOT_EXPERIMENTS, NUM_EXPERIMENTS_PER_SETUP) : NUM_EXPERIMENTS_PER_SETUP;
+	if(!ADAPTIVE_STOPPING) return NUM_EXPERIMENTS_PER_SETUP - numDone;
+	const double precisionRatio = pointResult.relativePrecision / TARGET_RELATIVE_PRECISION;
+	const double numNeeded      = std::isinf(precisionRatio) ? 2.0 * numDone : numDone * precisionRatio * precisionRatio;
+	int numNext = static_cast<int>(std::min<double>(numNeeded - numDone, MAX_EXPERIMENTS_PER_SETUP - numDone));
+	numNext = (numNext + NUM_EXPERIMENTS_PER_RANDOMISATION - 1) / NUM_EXPERIMENTS_PER_RANDOMISATION * NUM_EXPERIMENTS_PER_RANDOMISATION;
+	return std::max(NUM_EXPERIMENTS_PER_RANDOMISATION, numNext);
+}
+
+// Neyman allocation of a round: minimizing the sum of the squared relative precisions of the points
+// for a given cost gives n_h ~ s_h / sqrt(c_h), where s_h is the precision of a single experiment
+// (precision * sqrt(n)) and c_h is the mean number of updates of an experiment. The cumulative
+// targets are computed for the budget spent so far plus this round, the increments are scaled to the
+// round budget and rounded down to whole randomisations. A point whose precision is unknown yet is allocated
+// like the least precise point with a known one.
+std::vector<int> allocateBudgetRound(const std::vector<MeasurementPointResult>& pointResults, const std::vector<CostStatistics>& blockCosts, const double& roundBudgetUpdates)
+{
+	const int numPoints = pointResults.size();
+	std::vector<double> experimentCosts(numPoints, 0.0);
+	std::vector<double> priorities(numPoints, 0.0);
+	double spentUpdates = 0.0;
+	double normalization = 0.0;
+	double maxSingleExperimentPrecision = 0.0;
+	for(const MeasurementPointResult& pointResult: pointResults)
+	{
+		if(!std::isinf(pointResult.relativePrecision)) maxSingleExperimentPrecision = std::max(maxSingleExperimentPrecision, pointResult.relativePrecision * std::sqrt(pointResult.getNumExperiments()));
+	}
+	if(maxSingleExperimentPrecision == 0.0) maxSingleExperimentPrecision = 1.0;
+	for(int measurementPointIndex = 0; measurementPointIndex < numPoints; ++measurementPointIndex)
+	{
+		const MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+		experimentCosts[measurementPointIndex] = blockCosts[measurementPointIndex].getMean(NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(measurementPointIndex)) / NUM_EXPERIMENTS_PER_BLOCK;
+		spentUpdates += experimentCosts[measurementPointIndex] * pointResult.getNumExperiments();
+		if(pointResult.converged) continue;
+		const double singleExperimentPrecision = std::isinf(pointResult.relativePrecision) ? maxSingleExperimentPrecision : pointResult.relativePrecision * std::sqrt(pointResult.getNumExperiments());
+		priorities[measurementPointIndex] = singleExperimentPrecision / std::sqrt(experimentCosts[measurementPointIndex]);
+		normalization += singleExperimentPrecision * std::sqrt(experimentCosts[measurementPointIndex]);
+	}
+	std::vector<double> increments(numPoints, 0.0);
+	double incrementCost = 0.0;
+	for(int measurementPointIndex = 0; measurementPointIndex < numPoints && 0.0 < normalization; ++measurementPointIndex)
+	{
+		const double target = (spentUpdates + roundBudgetUpdates) / normalization * priorities[measurementPointIndex];
+		increments[measurementPointIndex] = std::max(0.0, target - pointResults[measurementPointIndex].getNumExperiments());
+		incrementCost += increments[measurementPointIndex] * experimentCosts[measurementPointIndex];
+	}
+	std::vector<int> roundExperiments(numPoints, 0);
+	for(int measurementPointIndex = 0; measurementPointIndex < numPoints && 0.0 < incrementCost; ++measurementPointIndex)
+	{
+		const double scaled  = increments[measurementPointIndex] * std::min(1.0, roundBudgetUpdates / incrementCost);
+		const int    maximum = MAX_EXPERIMENTS_PER_SETUP - pointResults[measurementPointIndex].getNumExperiments();
+		roundExperiments[measurementPointIndex] = std::min(maximum, static_cast<int>(scaled) / NUM_EXPERIMENTS_PER_RANDOMISATION * NUM_EXPERIMENTS_PER_RANDOMISATION);
+	}
+	// Rounding must not stall the run: the point of the highest priority gets at least one randomisation
+	if(std::accumulate(roundExperiments.begin(), roundExperiments.end(), 0) == 0)
+	{
+		const int bestPoint = std::max_element(priorities.begin(), priorities.end()) - priorities.begin();
+		if(0.0 < priorities[bestPoint]) roundExperiments[bestPoint] = NUM_EXPERIMENTS_PER_RANDOMISATION;
+	}
+	return roundExperiments;
+}
+
+// The rows of the matrix hold the hits per NUM_EXPERIMENTS_PER_SETUP experiments, so that measurement points
+// with different numbers of experiments (adaptive stopping, time budget) can be compared
+void copyToMatrixRow(HistogramAccumulator electronPositionsX, const int& numExperiments, TH2D& matrix_H, const int& measurementPointIndex)
+{
+	electronPositionsX.scale(NUM_EXPERIMENTS_PER_SETUP / static_cast<double>(numExperiments));
+	electronPositionsX.copyToHistogramRow(matrix_H, measurementPointIndex + 1);
+}
+
+// The current matrix histogram, overwritten after every round of a budgeted run
+void writeMatrixSnapshot(const std::vector<MeasurementPointResult>& pointResults)
+{
+	TH2D snapshot_H("electronEnergyEndPositionsX_snapshot",  "Electron end position distribution vs starting kin. energy;x pos(bohr);starting kin. energy (eV)",  
+		END_POS_NUM_BINS,                      END_POS_MIN_RANGE,                                                                  END_POS_MAX_RANGE,
+		ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, ELECTRON_START_KINETIC_ENERGY_EV_MIN - 0.5 * ELECTRON_START_KINETIC_ENERGY_EV_STEP, ELECTRON_START_KINETIC_ENERGY_EV_MAX + 0.5 * ELECTRON_START_KINETIC_ENERGY_EV_STEP);
+	for(int measurementPointIndex = 0; measurementPointIndex < static_cast<int>(pointResults.size()); ++measurementPointIndex)
+	{
+		if(pointResults[measurementPointIndex].electronPositionsXReplicates.size() < 2) continue;
+		copyToMatrixRow(estimateHistogram(pointResults[measurementPointIndex]), pointResults[measurementPointIndex].getNumExperiments(), snapshot_H, measurementPointIndex);
+	}
+	TFile snapshotFile(MATRIX_SNAPSHOT_FILE_NAME, "RECREATE");
+	snapshotFile.cd();
+	snapshot_H.Write();
+	snapshotFile.Close();
+}
+
+// Histograms of the detector observables, one per observable and measurement point
+void writeDetectorObservables(const std::vector<MeasurementPointResult>& pointResults)
+{
+	TFile observablesFile(DETECTOR_OBSERVABLES_FILE_NAME, "RECREATE");
+	observablesFile.cd();
+	for(int measurementPointIndex = 0; measurementPointIndex < static_cast<int>(pointResults.size()); ++measurementPointIndex)
+	{
+		for(unsigned int observableIndex = 0; observableIndex < DETECTOR_OBSERVABLES.size(); ++observableIndex)
+		{
+			const DetectorObservable&   observable = DETECTOR_OBSERVABLES[observableIndex];
+			const HistogramAccumulator& histogram  = pointResults[measurementPointIndex].observableHistograms[observableIndex];
+			TH1D observable_H((observable.name + "_" + std::to_string(measurementPointIndex)).c_str(), (observable.name + " at " + DETECTOR_SURFACES[observable.surfaceIndex].name).c_str(),
+				observable.numBins, observable.minRange, observable.maxRange);
+			histogram.copyToHistogram(observable_H);
+			observable_H.Write();
+		}
+	}
+	observablesFile.Close();
+	std::cout << "\nDetector observables written to " << DETECTOR_OBSERVABLES_FILE_NAME << "." << std::endl;
+}
+
+// Key of the results of a measurement point: every physics, geometry, integrator, sampling and estimator parameter they
+// depend on, the target of the experiments, the target the start conditions are sampled for and RESULT_CACHE_ENGINE_VERSION. The estimator names the code path filling the point.
+std::string measurementPointCacheKey(const int& numSetup, const ScatteringExperiment& experiment, const std::string& estimator)
+{
+	ConfigurationHash configuration;
+	configuration.add("RESULT_CACHE_ENGINE_VERSION", RESULT_CACHE_ENGINE_VERSION).add("estimator", estimator);
+	configuration.add("COULOMB_CONSTANT", COULOMB_CONSTANT).add("ELECTRON_CHARGE", ELECTRON_CHARGE).add("ELECTRON_MASS", ELECTRON_MASS).add("PROTON_CHARGE", PROTON_CHARGE);
+	// Charges other than PROTON_CHARGE are hashed only, so that the keys of the proton targets stay the same
+	const TargetGeometry& target = experiment.getTarget();
+	for(int chargeIndex = 0; chargeIndex < target.getNumCharges(); ++chargeIndex)
+	{
+		const vec3& protonPosition = target.getPositions()[chargeIndex];
+		configuration.add("protonPosition.x", protonPosition.x).add("protonPosition.y", protonPosition.y).add("protonPosition.z", protonPosition.z);
+		if(target.getCharges()[chargeIndex] != PROTON_CHARGE) configuration.add("charge", target.getCharges()[chargeIndex]);
+	}
+	configuration.add("ELECTRON_START_KINETIC_ENERGY", ELECTRON_START_KIN_ENERGIES[numSetup]).add("ELECTRON_START_VELOCITY", ELECTRON_START_VELOCITIES[numSetup]);
+	configuration.add("ELECTRON_START_X_POS_MIN", ELECTRON_START_X_POS_MIN).add("ELECTRON_START_X_POS_MAX", ELECTRON_START_X_POS_MAX);
+	configuration.add("ELECTRON_START_PLANE_DISTANCE", ELECTRON_START_PLANE_DISTANCE).add("ELECTRON_END_PLANE_DISTANCE", ELECTRON_END_PLANE_DISTANCE);
+	configuration.add("SAVE_2D_SCREENSHOTS", SAVE_2D_SCREENSHOTS).add("ELECTRON_START_Z_POS_MIN", ELECTRON_START_Z_POS_MIN).add("ELECTRON_START_Z_POS_MAX", ELECTRON_START_Z_POS_MAX);
+	configuration.add("END_POS_NUM_BINS", END_POS_NUM_BINS).add("END_POS_MIN_RANGE", END_POS_MIN_RANGE).add("END_POS_MAX_RANGE", END_POS_MAX_RANGE);
+	configuration.add("DT_STEP", DT_STEP).add("BOUND_STATE_MIN_PERIAPSES", BOUND_STATE_MIN_PERIAPSES).add("BOUND_STATE_REGION_MARGIN", BOUND_STATE_REGION_MARGIN);
+	configuration.add("NUM_EXPERIMENTS_PER_SETUP", NUM_EXPERIMENTS_PER_SETUP).add("NUM_EXPERIMENTS_PER_BLOCK", NUM_EXPERIMENTS_PER_BLOCK);
+	configuration.add("ADAPTIVE_STOPPING", ADAPTIVE_STOPPING).add("TARGET_RELATIVE_PRECISION", TARGET_RELATIVE_PRECISION);
+	configuration.add("CONVERGENCE_MIN_BIN_FRACTION", CONVERGENCE_MIN_BIN_FRACTION).add("MAX_EXPERIMENTS_PER_SETUP", MAX_EXPERIMENTS_PER_SETUP);
+	configuration.add("RANDOM_SEED", RANDOM_SEED).add("randomStreamSetup", randomStreamSetup(numSetup)).add("USE_QUASI_MONTE_CARLO", USE_QUASI_MONTE_CARLO);
+	configuration.add("NUM_INDEPENDENT_RANDOMISATIONS", NUM_INDEPENDENT_RANDOMISATIONS).add("IMPACT_PARAMETER_NUM_STRATA", IMPACT_PARAMETER_NUM_STRATA);
+	configuration.add("USE_ANTITHETIC_PAIRS", USE_ANTITHETIC_PAIRS).add("USE_IMPORTANCE_SAMPLING", USE_IMPORTANCE_SAMPLING);
+	configuration.add("IMPORTANCE_PEAK_HEIGHT", IMPORTANCE_PEAK_HEIGHT).add("IMPORTANCE_PEAK_WIDTH", IMPORTANCE_PEAK_WIDTH);
+	configuration.add("mirrorX", START_SYMMETRIES.mirrorX).add("mirrorZ", START_SYMMETRIES.mirrorZ);
+	// The importance density and the reduced model follow TARGET, not the target of the experiment (e.g. of a sweep)
+	for(int chargeIndex = 0; (USE_IMPORTANCE_SAMPLING || USE_CONTROL_VARIATES) && chargeIndex < TARGET.getNumCharges(); ++chargeIndex)
+	{
+		const vec3& chargePosition = TARGET.getPositions()[chargeIndex];
+		configuration.add("samplingTarget.x", chargePosition.x).add("samplingTarget.y", chargePosition.y).add("samplingTarget.z", chargePosition.z);
+		configuration.add("samplingTarget.charge", TARGET.getCharges()[chargeIndex]);
+	}
+	configuration.add("USE_CONTROL_VARIATES", USE_CONTROL_VARIATES).add("CONTROL_VARIATE_NUM_Y_STEPS", CONTROL_VARIATE_NUM_Y_STEPS);
+	configuration.add("CONTROL_VARIATE_Y_STEP_SCALE", CONTROL_VARIATE_Y_STEP_SCALE).add("CONTROL_VARIATE_QUADRATURE_POINTS", CONTROL_VARIATE_QUADRATURE_POINTS);
+	configuration.add("USE_ABSORPTION_PREDICTOR", USE_ABSORPTION_PREDICTOR).add("ABSORPTION_MAP_X_CELLS", ABSORPTION_MAP_X_CELLS).add("SURROGATE_NUM_Z_VELOCITY_SLICES", SURROGATE_NUM_Z_VELOCITY_SLICES);
+	configuration.add("ABSORPTION_MAP_MIN_ATTEMPTS", ABSORPTION_MAP_MIN_ATTEMPTS).add("ABSORPTION_PILOT_EXPERIMENTS", ABSORPTION_PILOT_EXPERIMENTS);
+	configuration.add("ABSORPTION_SURVIVAL_PROBABILITY", ABSORPTION_SURVIVAL_PROBABILITY);
+	configuration.add("USE_DETECTOR_STAGE", USE_DETECTOR_STAGE);
+	for(const auto& surface: USE_DETECTOR_STAGE ? DETECTOR_SURFACES : std::vector<DetectorSurface>())
+	{
+		configuration.add("surface.shape", static_cast<int>(surface.shape)).add("surface.radius", surface.radius);
+		configuration.add("surface.point", std::vector<float>{surface.point.x, surface.point.y, surface.point.z}).add("surface.normal", std::vector<float>{surface.normal.x, surface.normal.y, surface.normal.z});
+	}
+	for(const auto& observable: USE_DETECTOR_STAGE ? DETECTOR_OBSERVABLES : std::vector<DetectorObservable>())
+	{
+		configuration.add("observable.surfaceIndex", observable.surfaceIndex).add("observable.quantity", static_cast<int>(observable.quantity));
+		configuration.add("observable.numBins", observable.numBins).add("observable.minRange", observable.minRange).add("observable.maxRange", observable.maxRange);
+	}
+	return configuration.getKey();
+}
+
+// The screenshot hits are not cached: with SAVE_2D_SCREENSHOTS measurement point 0 is always simulated
+bool isCacheable(const int& numSetup)
 {
-	Particle::particleCollection.clear();
-	ChargedParticle::chargedParticleCollection.clear();
+	return !(numSetup == 0 && SAVE_2D_SCREENSHOTS);
+}
+
+// Takes over the merged results of a cached measurement point, the point counts as converged
+bool loadFromResultCache(const ResultCache& resultCache, const std::string& key, MeasurementPointResult& pointResult)
+{
+	CachedMeasurementPoint cachedPoint;
+	if(!resultCache.load(key, cachedPoint)) return false;
+	pointResult.numCachedExperiments         = cachedPoint.numExperiments;
+	pointResult.totalNumUpdates              = cachedPoint.totalNumUpdates;
+	pointResult.electronsAbsorbed            = cachedPoint.electronsAbsorbed;
+	pointResult.startsRejected               = cachedPoint.startsRejected;
+	pointResult.relativePrecision            = cachedPoint.relativePrecision;
+	pointResult.electronPositionsXReplicates = cachedPoint.electronPositionsXReplicates;
+	pointResult.modelControlReplicates       = cachedPoint.modelControlReplicates;
+	pointResult.modelHitProbabilities        = cachedPoint.modelHitProbabilities;
+	pointResult.observableHistograms         = cachedPoint.observableHistograms;
+	pointResult.converged                    = 1;
+	return true;
+}
+
+void storeInResultCache(const ResultCache& resultCache, const std::string& key, const MeasurementPointResult& pointResult)
+{
+	CachedMeasurementPoint cachedPoint;
+	cachedPoint.numExperiments               = pointResult.getNumExperiments();
+	cachedPoint.totalNumUpdates              = pointResult.totalNumUpdates;
+	cachedPoint.electronsAbsorbed            = pointResult.electronsAbsorbed;
+	cachedPoint.startsRejected               = pointResult.startsRejected;
+	cachedPoint.relativePrecision            = pointResult.relativePrecision;
+	cachedPoint.electronPositionsXReplicates = pointResult.electronPositionsXReplicates;
+	cachedPoint.modelControlReplicates       = pointResult.modelControlReplicates;
+	cachedPoint.modelHitProbabilities        = pointResult.modelHitProbabilities;
+	cachedPoint.observableHistograms         = pointResult.observableHistograms;
+	if(!resultCache.store(key, cachedPoint)) std::cout << "\nWarning: the results could not be written to the result cache " << RESULT_CACHE_DIRECTORY << "." << std::endl;
+}
+
+void writeBlockResult(std::ostream& stream, const ExperimentBlockResult& blockResult)
+{
+	std::vector<float> screenshotCoordinates;
+	for(const auto& hitPosition: blockResult.screenshotHits)
+	{
+		screenshotCoordinates.push_back(hitPosition.first);
+		screenshotCoordinates.push_back(hitPosition.second);
+	}
+	blockResult.electronPositionsX.write(stream);
+	writeValue  (stream, blockResult.totalNumUpdates);
+	writeValue  (stream, blockResult.electronsAbsorbed);
+	writeValues (stream, screenshotCoordinates);
+	writeValues (stream, blockResult.screenshotWeights);
+	blockResult.modelControl.write(stream);
+	writeValues (stream, blockResult.absorptionAttempts);
+	writeValue  (stream, blockResult.startsRejected);
+	writeObjects(stream, blockResult.observableHistograms);
+}
+
+bool readBlockResult(std::istream& stream, ExperimentBlockResult& blockResult)
+{
+	std::vector<float> screenshotCoordinates;
+	const bool complete =
+		blockResult.electronPositionsX.read(stream) && readValue(stream, blockResult.totalNumUpdates) && readValue(stream, blockResult.electronsAbsorbed) &&
+		readValues(stream, screenshotCoordinates) && readValues(stream, blockResult.screenshotWeights) && blockResult.modelControl.read(stream) &&
+		readValues(stream, blockResult.absorptionAttempts) && readValue(stream, blockResult.startsRejected) &&
+		readObjects(stream, blockResult.observableHistograms, HistogramAccumulator(0, 0.0, 1.0));
+	blockResult.screenshotHits.clear();
+	for(unsigned int index = 0; index + 1 < screenshotCoordinates.size(); index += 2) blockResult.screenshotHits.emplace_back(screenshotCoordinates[index], screenshotCoordinates[index + 1]);
+	return complete;
+}
+
+// A checkpoint only fits the configuration it was written by
+std::string checkpointConfigurationKey()
+{
+	ConfigurationHash configuration;
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		configuration.add("measurementPoint", measurementPointCacheKey(measurementPointIndex, SCATTERING_EXPERIMENT, "rounds"));
+	}
+	return configuration.getKey();
+}
+
+// Writes the merged state and the finished blocks of every measurement point, with the round they belong to. The random
+// streams have no state to save: every experiment has its own stream, keyed on its number (see createExperimentRandomGenerator()).
+// Called by the checkpoint thread during a round (the merged state is not changed then, the finished blocks not any more) and by
+// the main thread between the rounds. The file is written next to the checkpoint and renamed over it, so a run stopped while
+// writing keeps its previous checkpoint.
+void writeCheckpoint(const std::vector<MeasurementPointResult>& pointResults, const int& round)
+{
+	std::vector<std::vector<int>> finishedBlocks(pointResults.size());
+	{
+		std::unique_lock<std::mutex> lock(checkpointMutex);
+		for(unsigned int measurementPointIndex = 0; measurementPointIndex < pointResults.size(); ++measurementPointIndex)
+		{
+			const auto& blockResults = pointResults[measurementPointIndex].blockResults;
+			for(unsigned int blockIndex = 0; blockIndex < blockResults.size(); ++blockIndex) if(blockResults[blockIndex].finished) finishedBlocks[measurementPointIndex].push_back(blockIndex);
+		}
+	}
+	const std::string temporaryFileName = CHECKPOINT_FILE_NAME + std::string(".tmp");
+	{
+		std::ofstream stream(temporaryFileName, std::ios::binary | std::ios::trunc);
+		const std::string key = checkpointConfigurationKey();
+		writeValues(stream, std::vector<char>(key.begin(), key.end()));
+		writeValue (stream, round);
+		for(unsigned int measurementPointIndex = 0; measurementPointIndex < pointResults.size(); ++measurementPointIndex)
+		{
+			const MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+			writeValue  (stream, pointResult.numCachedExperiments);
+			writeValue  (stream, pointResult.numBlocksMerged);
+			writeValue  (stream, pointResult.totalNumUpdates);
+			writeValue  (stream, pointResult.electronsAbsorbed);
+			writeValue  (stream, pointResult.startsRejected);
+			writeValue  (stream, pointResult.relativePrecision);
+			writeValue  (stream, pointResult.converged);
+			writeObjects(stream, pointResult.electronPositionsXReplicates);
+			writeObjects(stream, pointResult.modelControlReplicates);
+			writeValues (stream, pointResult.modelHitProbabilities);
+			pointResult.absorptionMap.write(stream);
+			writeObjects(stream, pointResult.observableHistograms);
+			writeValue  (stream, static_cast<int>(pointResult.blockResults.size()));
+			writeValues (stream, finishedBlocks[measurementPointIndex]);
+			for(const auto& blockIndex: finishedBlocks[measurementPointIndex]) writeBlockResult(stream, pointResult.blockResults[blockIndex]);
+		}
+		if(!stream)
+		{
+			std::cout << "\nWarning: the checkpoint could not be written to " << temporaryFileName << "." << std::endl;
+			return;
+		}
+	}
+	std::rename(temporaryFileName.c_str(), CHECKPOINT_FILE_NAME);
+}
+
+// Restores the state written by writeCheckpoint() and returns the round to continue with.
+// Returns false if there is no complete checkpoint of this configuration.
+bool readCheckpoint(std::vector<MeasurementPointResult>& pointResults, int& round)
+{
+	std::ifstream stream(CHECKPOINT_FILE_NAME, std::ios::binary);
+	std::vector<char> key;
+	const std::string configurationKey = checkpointConfigurationKey();
+	if(!readValues(stream, key) || std::string(key.begin(), key.end()) != configurationKey || !readValue(stream, round)) return false;
+	for(auto& pointResult: pointResults)
+	{
+		int numBlocks = 0;
+		std::vector<int> finishedBlocks;
+		bool complete =
+			readValue(stream, pointResult.numCachedExperiments) && readValue(stream, pointResult.numBlocksMerged) && readValue(stream, pointResult.totalNumUpdates) &&
+			readValue(stream, pointResult.electronsAbsorbed) && readValue(stream, pointResult.startsRejected) && readValue(stream, pointResult.relativePrecision) &&
+			readValue(stream, pointResult.converged) &&
+			readObjects(stream, pointResult.electronPositionsXReplicates, HistogramAccumulator(0, 0.0, 1.0)) &&
+			readObjects(stream, pointResult.modelControlReplicates, ControlVariateAccumulator(0, 0.0, 1.0)) &&
+			readValues(stream, pointResult.modelHitProbabilities) && pointResult.absorptionMap.read(stream) &&
+			readObjects(stream, pointResult.observableHistograms, HistogramAccumulator(0, 0.0, 1.0)) &&
+			readValue(stream, numBlocks) && readValues(stream, finishedBlocks);
+		if(!complete || numBlocks < 0 || std::max(NUM_EXPERIMENTS_PER_SETUP, MAX_EXPERIMENTS_PER_SETUP) / NUM_EXPERIMENTS_PER_BLOCK < numBlocks) return false;
+		pointResult.blockResults.clear();
+		pointResult.blockResults.resize(numBlocks);
+		for(const auto& blockIndex: finishedBlocks)
+		{
+			if(blockIndex < 0 || numBlocks <= blockIndex || !readBlockResult(stream, pointResult.blockResults[blockIndex])) return false;
+			pointResult.blockResults[blockIndex].finished = 1;
+		}
+	}
+	return true;
+}
+
+// Shards split the randomisations, so the rounds have to be fixed in advance: no adaptive stopping, no time budget
+// and no absorption map learnt from the previous rounds
+bool isShardable()
+{
+	return RUN_TIME_BUDGET_SECONDS <= 0 && !ADAPTIVE_STOPPING && !USE_ABSORPTION_PREDICTOR && !USE_MULTILEVEL_MONTE_CARLO && !USE_SURROGATE_MAP && !USE_ENERGY_SWEEP_LANES && !USE_PARAMETER_SWEEP;
+}
+
+std::string shardFileName(const int& shardIndex, const int& numShards)
+{
+	return SHARD_FILE_NAME_PREFIX + std::string("_") + std::to_string(shardIndex) + "_of_" + std::to_string(numShards) + ".bin";
+}
+
+// Blocks [firstBlock, lastBlock) of the measurement points run by a shard: consecutive blocks, so that a missing shard
+// leaves out as few randomisations as possible
+void shardBlockRange(const int& shardIndex, const int& numShards, int& firstBlock, int& lastBlock)
+{
+	const int numBlocks = NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK;
+	firstBlock = shardIndex       * numBlocks / numShards;
+	lastBlock  = (shardIndex + 1) * numBlocks / numShards;
+}
+
+// Runs the shardIndex-th of numShards equal parts of the blocks of every measurement point and writes them to the shard
+// file. The experiments draw from their own random streams keyed on the experiment number, so the shards never overlap
+// and produce the same blocks as a single run. Up to one shard per block, a randomisation may span several shards.
+void runShard(WorkStealingScheduler& scheduler, const int& shardIndex, const int& numShards)
+{
+	int firstBlock, lastBlock;
+	shardBlockRange(shardIndex, numShards, firstBlock, lastBlock);
+	std::vector<MeasurementPointResult> pointResults(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS);
+	std::vector<WorkRange> blockRanges;
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		pointResults[measurementPointIndex].blockResults.resize(NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK);
+		if(firstBlock < lastBlock) blockRanges.push_back(WorkRange{measurementPointIndex, firstBlock, lastBlock});
+	}
+	std::cout << "Running shard " << shardIndex << " of " << numShards << ": blocks " << firstBlock << " to " << lastBlock - 1 << " of " << NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK
+		<< " (" << NUM_EXPERIMENTS_PER_BLOCK << " experiments each) of every measurement point." << std::endl;
+	Pbar shardProgress;
+	int percentPrinted = 0;
+	scheduler.run(blockRanges, [] (const int& measurementPointIndex)
+	{
+		return NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(measurementPointIndex);
+	}, [&pointResults] (const int& measurementPointIndex, const int& blockIndex)
+	{
+		MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+		ExperimentBlockResult blockResult; // in the memory of the worker's NUMA node
+		runExperimentBlock(measurementPointIndex, blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, pointResult.absorptionMap, blockResult);
+		pointResult.blockResults[blockIndex] = std::move(blockResult);
+	}, [&shardProgress, &percentPrinted] (const long long& numBlocksDone, const long long& numBlocksTotal)
+	{
+		const int percentDone = numBlocksDone * 100 / numBlocksTotal;
+		if(percentPrinted < percentDone)
+		{
+			shardProgress.update(percentDone - percentPrinted);
+			percentPrinted = percentDone;
+		}
+		shardProgress.print();
+	});
+	const std::string fileName = shardFileName(shardIndex, numShards);
+	const std::string temporaryFileName = fileName + ".tmp";
+	{
+		std::ofstream stream(temporaryFileName, std::ios::binary | std::ios::trunc);
+		const std::string key = checkpointConfigurationKey();
+		writeValues(stream, std::vector<char>(key.begin(), key.end()));
+		writeValue (stream, shardIndex);
+		writeValue (stream, numShards);
+		for(const auto& pointResult: pointResults)
+		{
+			std::vector<int> shardBlocks;
+			for(int blockIndex = firstBlock; blockIndex < lastBlock; ++blockIndex) shardBlocks.push_back(blockIndex);
+			writeValues(stream, shardBlocks);
+			for(const auto& blockIndex: shardBlocks) writeBlockResult(stream, pointResult.blockResults[blockIndex]);
+		}
+		if(!stream)
+		{
+			std::cout << "\nError: the shard could not be written to " << temporaryFileName << "." << std::endl;
+			return;
+		}
+	}
+	std::rename(temporaryFileName.c_str(), fileName.c_str());
+	std::cout << "\nShard written to " << fileName << "." << std::endl;
+}
+
+// Collects the blocks of the shard files, in any order, into the measurement points. A block found in several files is
+// taken once. Randomisations with blocks missing from the files are left out: the estimates use the complete ones, which
+// are merged in index order, so all the shards of a run give the results of a single run. A part of the shards gives
+// fewer replicates: the confidence intervals take their number, the matrix is normalised per experiment. Returns false
+// on files of another configuration and when a measurement point has less than two complete randomisations.
+bool mergeShardFiles(const std::vector<std::string>& fileNames, std::vector<MeasurementPointResult>& pointResults)
+{
+	constexpr int numBlocksPerRandomisation = NUM_EXPERIMENTS_PER_RANDOMISATION / NUM_EXPERIMENTS_PER_BLOCK;
+	const int numBlocks = NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK;
+	const std::string configurationKey = checkpointConfigurationKey();
+	std::vector<std::vector<ExperimentBlockResult>> blockResults(pointResults.size(), std::vector<ExperimentBlockResult>(numBlocks));
+	for(const auto& fileName: fileNames)
+	{
+		std::ifstream stream(fileName, std::ios::binary);
+		std::vector<char> key;
+		int shardIndex = 0;
+		int numShards  = 0;
+		bool complete = readValues(stream, key) && std::string(key.begin(), key.end()) == configurationKey && readValue(stream, shardIndex) && readValue(stream, numShards);
+		for(unsigned int measurementPointIndex = 0; complete && measurementPointIndex < pointResults.size(); ++measurementPointIndex)
+		{
+			std::vector<int> shardBlocks;
+			complete = readValues(stream, shardBlocks);
+			for(unsigned int index = 0; complete && index < shardBlocks.size(); ++index)
+			{
+				ExperimentBlockResult blockResult;
+				complete = 0 <= shardBlocks[index] && shardBlocks[index] < numBlocks && readBlockResult(stream, blockResult);
+				if(complete && !blockResults[measurementPointIndex][shardBlocks[index]].finished)
+				{
+					blockResults[measurementPointIndex][shardBlocks[index]] = std::move(blockResult);
+					blockResults[measurementPointIndex][shardBlocks[index]].finished = 1;
+				}
+			}
+		}
+		if(!complete)
+		{
+			std::cout << "Error: " << fileName << " is not a complete shard file of this configuration." << std::endl;
+			return false;
+		}
+		std::cout << "Read shard " << shardIndex << " of " << numShards << " from " << fileName << ".\n";
+	}
+	for(unsigned int measurementPointIndex = 0; measurementPointIndex < pointResults.size(); ++measurementPointIndex)
+	{
+		MeasurementPointResult& pointResult = pointResults[measurementPointIndex];
+		for(int randomisation = 0; randomisation < NUM_INDEPENDENT_RANDOMISATIONS; ++randomisation)
+		{
+			const auto first = blockResults[measurementPointIndex].begin() + randomisation * numBlocksPerRandomisation;
+			const auto last  = first + numBlocksPerRandomisation;
+			if(!std::all_of(first, last, [] (const ExperimentBlockResult& blockResult) { return blockResult.finished; })) continue;
+			pointResult.blockResults.insert(pointResult.blockResults.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+		}
+		const int numRandomisations = pointResult.getNumExperiments() / NUM_EXPERIMENTS_PER_RANDOMISATION;
+		if(numRandomisations < 2)
+		{
+			std::cout << "Error: measurement point " << measurementPointIndex << " has " << numRandomisations << " complete randomisation(s) in the shard files, at least two are needed." << std::endl;
+			return false;
+		}
+		if(numRandomisations < NUM_INDEPENDENT_RANDOMISATIONS)
+		{
+			std::cout << "Measurement point " << measurementPointIndex << ": " << numRandomisations << " of " << NUM_INDEPENDENT_RANDOMISATIONS << " randomisations found in the shard files.\n";
+		}
+		mergeNewBlockResults(pointResult);
+		pointResult.relativePrecision = calculateRelativePrecision(estimateHistogram(pointResult));
+		pointResult.converged = 1;
+	}
+	return true;
+}
+
+// Median over the populated bins of the 95% confidence interval half-width relative to the bin content.
+// The bin errors come from the spread of numReplicates independent randomisations, the interval uses the
+// Student t quantile of their degrees of freedom (the normal quantile for errors not estimated from replicates).
+void printConfidenceIntervalSummary(const int& numSetup, const HistogramAccumulator& electronPositionsX, const int& numReplicates)
+{
+	const double tValue = studentTQuantile975(numReplicates - 1);
+	std::vector<double> relativeHalfWidths;
+	for(int bin = 1; bin <= electronPositionsX.getNumBins(); ++bin)
+	{
+		if(electronPositionsX.getBinContent(bin) <= 0) continue;
+		relativeHalfWidths.push_back(tValue * electronPositionsX.getBinError(bin) / electronPositionsX.getBinContent(bin));
+	}
+	if(relativeHalfWidths.empty()) return;
+	std::nth_element(relativeHalfWidths.begin(), relativeHalfWidths.begin() + relativeHalfWidths.size() / 2, relativeHalfWidths.end());
+	std::cout << "\nMeasurement point " << numSetup << ": median relative 95% confidence interval half-width of the " << relativeHalfWidths.size() << " populated bins: " << relativeHalfWidths[relativeHalfWidths.size() / 2] << std::flush;
+}
+
+// Runs the experiments [firstExperiment, firstExperiment + numExperiments) of a measurement point
+// on the calling thread, absorbed experiments are repeated with new starting conditions. Start conditions
+// predicted to absorb by the absorption map play Russian roulette: they are integrated with probability
+// ABSORPTION_SURVIVAL_PROBABILITY and the rest of the experiment (retries included) is weighted by
+// its inverse, otherwise the experiment ends without a hit. The prediction then only saves integrations and
+// never biases the result, even where a predicted cell does not absorb everywhere.
+// Returns the number of updates done, absorbed experiments included.
+long long runExperimentBlock(const int& numSetup, const int& firstExperiment, const int& numExperiments, const AbsorptionMap& absorptionMap, ExperimentBlockResult& result)
+{
+	long long numUpdatesIncludingAbsorbed = 0;
+	for(int experimentNumber = firstExperiment; experimentNumber < firstExperiment + numExperiments; ++experimentNumber)
+	{
+		PhiloxRandom randomGenerator = createExperimentRandomGenerator(numSetup, experimentNumber);
+		double survivalWeight = 1.0;
+		StartConditions firstStartConditions;
+		for(int attempt = 0; ; ++attempt)
+		{
+			int numUpdates = 0;
+			int experimentSuccesful = 0;
+			std::vector<DetectorCrossing> crossings;
+			StartConditions startConditions = drawStartConditions(numSetup, experimentNumber, attempt, randomGenerator);
+			if(attempt == 0) firstStartConditions = startConditions;
+			if(USE_ABSORPTION_PREDICTOR && absorptionMap.isPredictedAbsorbing(startConditions.x, startConditions.zVelocitySample))
+			{
+				if(ABSORPTION_SURVIVAL_PROBABILITY <= randomGenerator.uniform())
+				{
+					result.startsRejected++;
+					if(USE_CONTROL_VARIATES) result.modelControl.fillControl(reducedModelHitX(numSetup, firstStartConditions.x), firstStartConditions.weight);
+					break;
+				}
+				survivalWeight /= ABSORPTION_SURVIVAL_PROBABILITY;
+			}
+			startConditions.weight *= survivalWeight;
+			initExperiment(numSetup, startConditions);
+			vec3 electronHitPosition = runExperiment(numUpdates, experimentSuccesful, DT_STEP, USE_DETECTOR_STAGE ? &crossings : nullptr);
+			numUpdatesIncludingAbsorbed += numUpdates;
+			if(USE_ABSORPTION_PREDICTOR) result.absorptionAttempts.push_back(AbsorptionMap::Attempt{startConditions.x, startConditions.zVelocitySample, !experimentSuccesful});
+			if(!experimentSuccesful)
+			{
+				result.electronsAbsorbed++;
+				continue;
+			}
+			recordHit(numSetup, startConditions, firstStartConditions, electronHitPosition, numUpdates, result);
+			if(USE_DETECTOR_STAGE) DETECTOR_STAGE.fill(crossings, startConditions.weight, START_SYMMETRIES.mirrorX, START_SYMMETRIES.mirrorZ, result.observableHistograms);
+			break;
+		}
+	}
+	return numUpdatesIncludingAbsorbed;
+}
+
+// Fills the hit of a successful experiment into the results of its block. The control variate is taken from the start
+// conditions of the first attempt of the experiment (see calculateModelHitProbabilities).
+void recordHit(const int& numSetup, const StartConditions& startConditions, const StartConditions& firstStartConditions, const vec3& electronHitPosition, const int& numUpdates, ExperimentBlockResult& result)
+{
+	if(numSetup == 0 && SAVE_2D_SCREENSHOTS)
+	{
+		result.screenshotHits.emplace_back(electronHitPosition.x, electronHitPosition.z);
+		result.screenshotWeights.push_back(startConditions.weight);
+	}
+	result.electronPositionsX.fill(electronHitPosition.x, startConditions.weight);
+	if(USE_CONTROL_VARIATES) result.modelControl.fill(electronHitPosition.x, startConditions.weight, reducedModelHitX(numSetup, firstStartConditions.x), firstStartConditions.weight);
+	result.totalNumUpdates += numUpdates;
+}
+
+// Same experiment as runExperiment() for the measurement points [firstSetup, firstSetup + ENERGY_SWEEP_LANE_WIDTH)
+// at once, one lane per energy. Lanes past the last measurement point stay inactive. The bundle and the classifiers are
+// those of the block (see runEnergySweepBlock), every lane is set and every classifier is reset here.
+void runExperimentLanes(ElectronBundle<ENERGY_SWEEP_LANE_WIDTH>& electrons, std::vector<BoundStateClassifier>& absorptionClassifiers, const int& firstSetup, const StartConditions& startConditions,
+	vec3* hitPositions, int* numUpdates, int* experimentsSuccesful)
+{
+	int numActive = 0;
+	for(int lane = 0; lane < ENERGY_SWEEP_LANE_WIDTH; ++lane)
+	{
+		absorptionClassifiers[lane].reset();
+		numUpdates[lane]           = 0;
+		experimentsSuccesful[lane] = 0;
+		const int numSetup = firstSetup + lane;
+		// Inactive lanes are parked on the start plane, away from the protons
+		const float startSpeed = numSetup < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS ? ELECTRON_START_VELOCITIES[numSetup] : 0.0f;
+		const float vz = SAVE_2D_SCREENSHOTS ? startConditions.zVelocitySample * (ELECTRON_START_Z_POS_MAX - ELECTRON_START_Z_POS_MIN) + ELECTRON_START_Z_POS_MIN : 0.0f;
+		electrons.setLane(lane, vec3(startConditions.x, ELECTRON_START_PLANE_DISTANCE, 0.0f), vec3(0.0f, -startSpeed, vz));
+		if(numSetup < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS) ++numActive;
+		else electrons.deactivate(lane);
+	}
+	while(0 < numActive)
+	{
+		electrons.update(DT_STEP);
+		for(int lane = 0; lane < ENERGY_SWEEP_LANE_WIDTH; ++lane)
+		{
+			if(!electrons.isActive(lane)) continue;
+			numUpdates[lane]++;
+			const vec3 electronPosition = electrons.getPosition(lane);
+			const bool hit      = electronPosition.y < -ELECTRON_END_PLANE_DISTANCE;
+			const bool absorbed = !hit && absorptionClassifiers[lane].update(electrons.getStageTotalEnergy(lane), electronPosition, electrons.getStagePotential(lane));
+			if(!hit && !absorbed) continue;
+			hitPositions[lane]         = electronPosition;
+			experimentsSuccesful[lane] = hit;
+			electrons.deactivate(lane);
+			--numActive;
+		}
+	}
+}
+
+// Runs the experiments [firstExperiment, firstExperiment + numExperiments) at every energy with common start
+// conditions, results[numSetup] receiving the hits of the measurement point. An absorbed experiment is repeated
+// with the next start conditions on the scalar path, continuing a copy of the common random stream. The sources
+// are copied into the bundle once per block rather than for every experiment.
+// Returns the number of updates done, absorbed experiments included.
+long long runEnergySweepBlock(const int& firstExperiment, const int& numExperiments, std::vector<ExperimentBlockResult*>& results)
+{
+	const TargetGeometry& target = SCATTERING_EXPERIMENT.getTarget();
+	std::vector<float> sourceCharges(target.getCharges(), target.getCharges() + target.getNumCharges());
+	for(auto& sourceCharge: sourceCharges) sourceCharge *= COULOMB_CONSTANT;
+	ElectronBundle<ENERGY_SWEEP_LANE_WIDTH> electrons(ELECTRON_CHARGE, ELECTRON_MASS, std::vector<vec3>(target.getPositions(), target.getPositions() + target.getNumCharges()), sourceCharges);
+	std::vector<BoundStateClassifier> absorptionClassifiers(ENERGY_SWEEP_LANE_WIDTH, createAbsorptionClassifier());
+	long long numUpdatesIncludingAbsorbed = 0;
+	for(int experimentNumber = firstExperiment; experimentNumber < firstExperiment + numExperiments; ++experimentNumber)
+	{
+		PhiloxRandom randomGenerator = createExperimentRandomGenerator(0, experimentNumber);
+		const StartConditions startConditions = drawStartConditions(0, experimentNumber, 0, randomGenerator);
+		for(int firstSetup = 0; firstSetup < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; firstSetup += ENERGY_SWEEP_LANE_WIDTH)
+		{
+			vec3 hitPositions[ENERGY_SWEEP_LANE_WIDTH];
+			int  numUpdates[ENERGY_SWEEP_LANE_WIDTH];
+			int  experimentsSuccesful[ENERGY_SWEEP_LANE_WIDTH];
+			runExperimentLanes(electrons, absorptionClassifiers, firstSetup, startConditions, hitPositions, numUpdates, experimentsSuccesful);
+			for(int numSetup = firstSetup; numSetup < std::min(firstSetup + ENERGY_SWEEP_LANE_WIDTH, ELECTRON_START_KIN_EN_NUM_MEAS_POINTS); ++numSetup)
+			{
+				const int lane = numSetup - firstSetup;
+				numUpdatesIncludingAbsorbed += numUpdates[lane];
+				if(experimentsSuccesful[lane])
+				{
+					recordHit(numSetup, startConditions, startConditions, hitPositions[lane], numUpdates[lane], *results[numSetup]);
+					continue;
+				}
+				results[numSetup] -> electronsAbsorbed++;
+				PhiloxRandom retryRandomGenerator = randomGenerator;
+				for(int attempt = 1; ; ++attempt)
+				{
+					int numRetryUpdates = 0;
+					int experimentSuccesful = 0;
+					StartConditions retryStartConditions = drawStartConditions(numSetup, experimentNumber, attempt, retryRandomGenerator);
+					initExperiment(numSetup, retryStartConditions);
+					vec3 electronHitPosition = runExperiment(numRetryUpdates, experimentSuccesful);
+					numUpdatesIncludingAbsorbed += numRetryUpdates;
+					if(!experimentSuccesful)
+					{
+						results[numSetup] -> electronsAbsorbed++;
+						continue;
+					}
+					recordHit(numSetup, retryStartConditions, startConditions, electronHitPosition, numRetryUpdates, *results[numSetup]);
+					break;
+				}
+			}
+		}
+	}
+	return numUpdatesIncludingAbsorbed;
+}
+
+// Repeats a single experiment of a run (absorbed attempts included) and prints every attempt.
+// The absorption map of a run is not stored: start conditions it rejected are integrated here.
+void replayExperiment(const int& numSetup, const int& experimentNumber)
+{
+	if(numSetup < 0 || ELECTRON_START_KIN_EN_NUM_MEAS_POINTS <= numSetup || experimentNumber < 0 || (ADAPTIVE_STOPPING ? MAX_EXPERIMENTS_PER_SETUP : NUM_EXPERIMENTS_PER_SETUP) <= experimentNumber)
+	{
+		std::cout << "Error: no experiment " << experimentNumber << " in measurement point " << numSetup << "." << std::endl;
+		return;
+	}
+	std::cout << "Replaying experiment " << experimentNumber << " of measurement point " << numSetup << " (" << ELECTRON_START_KIN_ENERGIES[numSetup] << " eV)" << std::endl;
+	PhiloxRandom randomGenerator = createExperimentRandomGenerator(numSetup, experimentNumber);
+	for(int attempt = 0; ; ++attempt)
+	{
+		int numUpdates = 0;
+		int experimentSuccesful = 0;
+		StartConditions startConditions = drawStartConditions(numSetup, experimentNumber, attempt, randomGenerator);
+		initExperiment(numSetup, startConditions);
+		const ChargedParticle& electron = SCATTERING_EXPERIMENT.getElectron();
+		vec3 startPosition = electron.getPosition();
+		vec3 startVelocity = electron.getVelocity();
+		vec3 electronHitPosition = runExperiment(numUpdates, experimentSuccesful);
+		std::cout << "Attempt " << attempt << ": start position (" << startPosition.x << ", " << startPosition.y << ", " << startPosition.z << ")"
+			<< ", start velocity (" << startVelocity.x << ", " << startVelocity.y << ", " << startVelocity.z << ")"
+			<< ", weight " << startConditions.weight << ", " << numUpdates << " updates, "
+			<< (experimentSuccesful ? "hit" : "absorbed") << " at (" << electronHitPosition.x << ", " << electronHitPosition.y << ", " << electronHitPosition.z << ")" << std::endl;
+		if(experimentSuccesful) break;
+	}
+	clearExperiment();
+}
+
+// Time step of a multilevel Monte Carlo level, the last level uses DT_STEP
+float multilevelTimeStep(const int& level)
+{
+	return DT_STEP * (1 << (MULTILEVEL_NUM_LEVELS - 1 - level));
+}
+
+// A sample of a level l > 0 runs the same start conditions with the time steps of level l and l - 1.
+// Each time step repeats its own absorbed attempts from the same stream, as the single level runs do, so the
+// two follow the same start conditions until only one of them is absorbed, and every time step estimates the
+// hit distribution of its single level run: the level differences add up to the finest level without bias.
+// The levels use disjoint ranges of experiment numbers, so their samples are independent.
+// Returns the number of updates done, absorbed experiments included.
+long long runMultilevelExperimentBlock(const int& numSetup, const int& level, const int& firstExperiment, const int& numExperiments, MultilevelBlockResult& result)
+{
+	long long numUpdatesIncludingAbsorbed = 0;
+	for(int experimentNumber = firstExperiment; experimentNumber < firstExperiment + numExperiments; ++experimentNumber)
+	{
+		const int streamExperimentNumber = level * MAX_EXPERIMENTS_PER_SETUP + experimentNumber;
+		long long experimentNumUpdates = 0;
+		// Hit of the first attempt that is not absorbed, the retries keep the weight of the first attempt
+		auto runUntilHit = [&] (const float& timeStep, StartConditions& startConditions)
+		{
+			PhiloxRandom randomGenerator = createExperimentRandomGenerator(numSetup, streamExperimentNumber);
+			for(int attempt = 0; ; ++attempt)
+			{
+				int numUpdates = 0;
+				int experimentSuccesful = 0;
+				startConditions = drawStartConditions(numSetup, streamExperimentNumber, attempt, randomGenerator);
+				initExperiment(numSetup, startConditions);
+				vec3 hitPosition = runExperiment(numUpdates, experimentSuccesful, timeStep);
+				experimentNumUpdates += numUpdates;
+				if(experimentSuccesful) return hitPosition;
+				result.electronsAbsorbed++;
+			}
+		};
+		StartConditions startConditions;
+		const vec3 fineHitPosition = runUntilHit(multilevelTimeStep(level), startConditions);
+		vec3 coarseHitPosition;
+		if(0 < level)
+		{
+			StartConditions coarseStartConditions;
+			coarseHitPosition = runUntilHit(multilevelTimeStep(level - 1), coarseStartConditions);
+		}
+		result.levelSums.addSample(fineHitPosition.x, 0 < level, coarseHitPosition.x, startConditions.weight, experimentNumUpdates);
+		numUpdatesIncludingAbsorbed += experimentNumUpdates;
+	}
+	return numUpdatesIncludingAbsorbed;
+}
+
+// Multilevel Monte Carlo over the time step: many cheap coarse experiments and fewer coupled fine/coarse
+// corrections. After a pilot round the number of samples of every level is re-optimized from the measured
+// variances and costs, until the variance of the estimate is below TARGET_RELATIVE_PRECISION^2 times the
+// squared L2 norm of the histogram. The results are scaled to NUM_EXPERIMENTS_PER_SETUP experiments.
+std::vector<HistogramAccumulator> runMultilevelMonteCarlo(WorkStealingScheduler& scheduler)
+{
+	// Work groups: measurement point * MULTILEVEL_NUM_LEVELS + level
+	const int numGroups = ELECTRON_START_KIN_EN_NUM_MEAS_POINTS * MULTILEVEL_NUM_LEVELS;
+	std::vector<std::vector<MultilevelBlockResult>> blockResults(numGroups);
+	std::vector<int>                                numBlocksMerged(numGroups, 0);
+	std::vector<long long>                          targetNumSamples(numGroups, MULTILEVEL_NUM_PILOT_EXPERIMENTS);
+	std::vector<CostStatistics>                     blockCosts(numGroups);
+	std::vector<int>                                electronsAbsorbed(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, 0);
+	std::vector<MultilevelHistogramEstimator>       estimators(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, MultilevelHistogramEstimator(MULTILEVEL_NUM_LEVELS, END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE));
+	auto expectedBlockCost = [&blockCosts] (const int& group)
+	{
+		const int level = group % MULTILEVEL_NUM_LEVELS;
+		const double timeStepsPerDtStep = DT_STEP / multilevelTimeStep(level) + (0 < level ? DT_STEP / multilevelTimeStep(level - 1) : 0.0);
+		const CostStatistics& costs = blockCosts[group];
+		return costs.getMean(NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(group / MULTILEVEL_NUM_LEVELS) * timeStepsPerDtStep) + costs.getStandardDeviation();
+	};
+	auto processBlock = [&blockResults, &blockCosts] (const int& group, const int& blockIndex)
+	{
+		MultilevelBlockResult blockResult; // in the memory of the worker's NUMA node
+		long long blockCost = runMultilevelExperimentBlock(group / MULTILEVEL_NUM_LEVELS, group % MULTILEVEL_NUM_LEVELS, blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, blockResult);
+		blockResults[group][blockIndex] = std::move(blockResult);
+		blockCosts[group].add(blockCost);
+	};
+	for(int round = 0; ; ++round)
+	{
+		std::vector<WorkRange> blockRanges;
+		for(int group = 0; group < numGroups; ++group)
+		{
+			// Whole randomisations, so that the strata of the start x stay balanced
+			long long numNeeded = (targetNumSamples[group] + NUM_EXPERIMENTS_PER_RANDOMISATION - 1) / NUM_EXPERIMENTS_PER_RANDOMISATION * NUM_EXPERIMENTS_PER_RANDOMISATION;
+			numNeeded = std::min<long long>(numNeeded, MAX_EXPERIMENTS_PER_SETUP);
+			const int firstBlock = blockResults[group].size();
+			if(numNeeded <= firstBlock * NUM_EXPERIMENTS_PER_BLOCK) continue;
+			blockResults[group].resize(numNeeded / NUM_EXPERIMENTS_PER_BLOCK);
+			blockRanges.push_back(WorkRange{group, firstBlock, static_cast<int>(blockResults[group].size())});
+		}
+		if(blockRanges.empty()) break;
+		std::cout << "\nMultilevel round " << round << ":\n";
+		Pbar roundProgress;
+		int percentPrinted = 0;
+		auto printProgress = [&roundProgress, &percentPrinted] (const long long& numBlocksDone, const long long& numBlocksTotal)
+		{
+			const int percentDone = numBlocksDone * 100 / numBlocksTotal;
+			if(percentPrinted < percentDone)
+			{
+				roundProgress.update(percentDone - percentPrinted);
+				percentPrinted = percentDone;
+			}
+			roundProgress.print();
+		};
+		scheduler.run(blockRanges, expectedBlockCost, processBlock, printProgress);
+		for(const auto& blockRange: blockRanges)
+		{
+			const int measurementPointIndex = blockRange.group / MULTILEVEL_NUM_LEVELS;
+			for(; numBlocksMerged[blockRange.group] < blockRange.end; ++numBlocksMerged[blockRange.group])
+			{
+				const MultilevelBlockResult& blockResult = blockResults[blockRange.group][numBlocksMerged[blockRange.group]];
+				estimators[measurementPointIndex].getLevel(blockRange.group % MULTILEVEL_NUM_LEVELS).add(blockResult.levelSums);
+				electronsAbsorbed[measurementPointIndex] += blockResult.electronsAbsorbed;
+			}
+		}
+		for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+		{
+			const HistogramAccumulator estimate = estimators[measurementPointIndex].estimate(1.0);
+			double squaredNorm = 0.0;
+			for(int bin = 0; bin < estimate.getNumBins() + 2; ++bin) squaredNorm += estimate.getBinContent(bin) * estimate.getBinContent(bin);
+			if(squaredNorm <= 0.0) continue;
+			const std::vector<long long> optimalNumSamples = estimators[measurementPointIndex].optimalNumSamples(TARGET_RELATIVE_PRECISION * TARGET_RELATIVE_PRECISION * squaredNorm);
+			for(int level = 0; level < MULTILEVEL_NUM_LEVELS; ++level) targetNumSamples[measurementPointIndex * MULTILEVEL_NUM_LEVELS + level] = optimalNumSamples[level];
+		}
+	}
+	std::vector<HistogramAccumulator> estimates;
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		const MultilevelHistogramEstimator& estimator = estimators[measurementPointIndex];
+		estimates.push_back(unfoldSymmetries(estimator.estimate(NUM_EXPERIMENTS_PER_SETUP), estimator.mirrorCovariances(NUM_EXPERIMENTS_PER_SETUP)));
+		const HistogramAccumulator estimate = estimator.estimate(1.0);
+		double squaredNorm = 0.0;
+		for(int bin = 0; bin < estimate.getNumBins() + 2; ++bin) squaredNorm += estimate.getBinContent(bin) * estimate.getBinContent(bin);
+		std::cout << "\nMeasurement point " << measurementPointIndex << " (" << electronsAbsorbed[measurementPointIndex] << " absorbed attempts):";
+		for(int level = 0; level < MULTILEVEL_NUM_LEVELS; ++level)
+		{
+			const LevelDifferenceAccumulator& levelSums = estimator.getLevel(level);
+			std::cout << "\n\tlevel " << level << ", DT step " << std::setw(8) << multilevelTimeStep(level) << ": " << std::setw(7) << levelSums.getNumSamples() << " samples, "
+				<< std::setw(8) << levelSums.getMeanCost() << " updates per sample, variance " << levelSums.getTotalVariance();
+		}
+		// The mean correction of the finest level estimates the time step bias left in the result
+		std::cout << "\n\trelative size of the finest correction: " << estimator.getLevel(MULTILEVEL_NUM_LEVELS - 1).getMeanNorm() / std::sqrt(std::max(squaredNorm, 1e-300)) << std::flush;
+	}
+	return estimates;
+}
+
+// Hit histograms from adaptively refined start x -> hit x maps, one full experiment per node. The z velocity
+// moves the electron off the proton line by a fraction of a bohr, so there is one map for each of the
+// SURROGATE_NUM_Z_VELOCITY_SLICES z velocities (midpoint rule). The maps are deterministic, so there are no replicates
+// to take errors from: the bin errors hold an interpolation-difference indicator instead, the difference to the maps
+// through every other node of the same evaluations (see AdaptiveHitMap::pushForward) combined with the difference of
+// the even and odd slices. It shows where the maps are not resolved, it is no statistical error and no confidence
+// intervals are derived from it. The results are scaled to NUM_EXPERIMENTS_PER_SETUP experiments.
+std::vector<HistogramAccumulator> runSurrogateMaps(WorkStealingScheduler& scheduler)
+{
+	std::vector<HistogramAccumulator> estimates;
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		HistogramAccumulator estimate(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+		std::vector<double> interpolationDifferences(END_POS_NUM_BINS + 2, 0.0);
+		std::vector<double> sliceParitySums[2] = {std::vector<double>(END_POS_NUM_BINS + 2, 0.0), std::vector<double>(END_POS_NUM_BINS + 2, 0.0)};
+		std::atomic<long long> totalNumUpdates(0);
+		int numNodes      = 0;
+		int numUnresolved = 0;
+		for(int slice = 0; slice < SURROGATE_NUM_Z_VELOCITY_SLICES; ++slice)
+		{
+			const float zVelocitySample = START_SYMMETRIES.mirrorZ ? 0.5f + 0.5f * (slice + 0.5f) / SURROGATE_NUM_Z_VELOCITY_SLICES : (slice + 0.5f) / SURROGATE_NUM_Z_VELOCITY_SLICES;
+			AdaptiveHitMap hitMap(SURROGATE_MIN_START_X_STEP, SURROGATE_MAX_HIT_STEP, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+			auto evaluateNodes = [&scheduler, &totalNumUpdates, measurementPointIndex, zVelocitySample] (std::vector<AdaptiveHitMap::Node>& nodes)
+			{
+				std::vector<WorkRange> nodeRange(1, WorkRange{0, 0, static_cast<int>(nodes.size())});
+				scheduler.run(nodeRange, [measurementPointIndex] (const int&) { return expectedNumUpdatesPerExperiment(measurementPointIndex); },
+					[&nodes, &totalNumUpdates, measurementPointIndex, zVelocitySample] (const int&, const int& nodeIndex)
+				{
+					int numUpdates = 0;
+					int experimentSuccesful = 0;
+					initExperiment(measurementPointIndex, StartConditions{static_cast<float>(nodes[nodeIndex].startX), zVelocitySample, 1.0});
+					nodes[nodeIndex].hitX     = runExperiment(numUpdates, experimentSuccesful).x;
+					nodes[nodeIndex].absorbed = !experimentSuccesful;
+					totalNumUpdates += numUpdates;
+				}, [] (const long long&, const long long&) {});
+			};
+			hitMap.build(ELECTRON_START_X_SAMPLING_MIN, ELECTRON_START_X_POS_MAX, SURROGATE_INITIAL_NODES, SURROGATE_MAX_NODES, evaluateNodes);
+			const double sliceWeight = static_cast<double>(NUM_EXPERIMENTS_PER_SETUP) / SURROGATE_NUM_Z_VELOCITY_SLICES;
+			const HistogramAccumulator sliceEstimate      = hitMap.pushForward(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE, sliceWeight);
+			const HistogramAccumulator sliceHalfNodes     = hitMap.pushForward(END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE, sliceWeight, 2);
+			for(int bin = 0; bin < END_POS_NUM_BINS + 2; ++bin)
+			{
+				estimate.setBinContent(bin, estimate.getBinContent(bin) + sliceEstimate.getBinContent(bin));
+				interpolationDifferences[bin]  += std::abs(sliceEstimate.getBinContent(bin) - sliceHalfNodes.getBinContent(bin));
+				sliceParitySums[slice % 2][bin] += sliceEstimate.getBinContent(bin);
+			}
+			numNodes      += hitMap.getNumNodes();
+			numUnresolved += hitMap.getNumUnresolved();
+		}
+		for(int bin = 0; bin < END_POS_NUM_BINS + 2; ++bin)
+		{
+			const double sliceDifference = SURROGATE_NUM_Z_VELOCITY_SLICES < 2 ? 0.0 : 0.5 * std::abs(sliceParitySums[0][bin] - sliceParitySums[1][bin]);
+			estimate.setBinError(bin, std::sqrt(interpolationDifferences[bin] * interpolationDifferences[bin] + sliceDifference * sliceDifference));
+		}
+		estimate.setNumEntries(NUM_EXPERIMENTS_PER_SETUP);
+		// The indicators of a bin and its mirror bin come from the same maps, they are taken as fully correlated
+		std::vector<double> mirrorCovariances(END_POS_NUM_BINS + 2);
+		for(int bin = 0; bin < END_POS_NUM_BINS + 2; ++bin) mirrorCovariances[bin] = estimate.getBinError(bin) * estimate.getBinError(END_POS_NUM_BINS + 1 - bin);
+		estimates.push_back(unfoldSymmetries(estimate, mirrorCovariances));
+		std::cout << "\nMeasurement point " << measurementPointIndex << ": surrogate maps of " << numNodes << " nodes, " << numUnresolved << " unresolved intervals, "
+			<< totalNumUpdates / static_cast<double>(numNodes) << " updates per node (bin errors: interpolation-difference indicator, not statistical)." << std::flush;
+	}
+	return estimates;
+}
+
+// Runs the experiments [firstExperiment, firstExperiment + numExperiments) of the energy numSetup on a sweep target,
+// as runExperimentBlock() does without the absorption predictor, the control variates and the detector stage.
+// Returns the number of updates done, absorbed experiments included.
+long long runSweepBlock(const SweepTarget& target, const int& numSetup, const int& firstExperiment, const int& numExperiments, ExperimentBlockResult& result)
+{
+	long long numUpdatesIncludingAbsorbed = 0;
+	for(int experimentNumber = firstExperiment; experimentNumber < firstExperiment + numExperiments; ++experimentNumber)
+	{
+		PhiloxRandom randomGenerator = createExperimentRandomGenerator(numSetup, experimentNumber);
+		for(int attempt = 0; ; ++attempt)
+		{
+			int numUpdates = 0;
+			int experimentSuccesful = 0;
+			StartConditions startConditions = drawStartConditions(numSetup, experimentNumber, attempt, randomGenerator);
+			initExperiment(numSetup, startConditions, target.experiment);
+			vec3 electronHitPosition = runExperiment(target.experiment, target.absorptionClassifier, numUpdates, experimentSuccesful);
+			numUpdatesIncludingAbsorbed += numUpdates;
+			if(!experimentSuccesful)
+			{
+				result.electronsAbsorbed++;
+				continue;
+			}
+			result.electronPositionsX.fill(electronHitPosition.x, startConditions.weight);
+			result.totalNumUpdates += numUpdates;
+			break;
+		}
+	}
+	return numUpdatesIncludingAbsorbed;
+}
+
+// NUM_EXPERIMENTS_PER_SETUP experiments at every point of the grid numbers of protons x proton-proton distances x energies,
+// in a single process and a single round: the blocks of every point are scheduled at once. The points of a geometry share
+// their target, the worker threads only move their particles when they switch geometry. The start conditions depend on
+// the energy index only, so the geometries are compared with common random numbers. Every centered proton line is mirror
+// symmetric, START_SYMMETRIES holds for every geometry. With USE_RESULT_CACHE only the points missing from the cache
+// are simulated. The result cube is written to PARAMETER_SWEEP_FILE_NAME as one end position vs energy matrix per geometry.
+void runParameterSweep(WorkStealingScheduler& scheduler)
+{
+	const ParameterGrid grid({
+		ParameterGrid::Axis{"numberOfProtons",      std::vector<double>(SWEEP_NUMBERS_OF_PROTONS.begin(),      SWEEP_NUMBERS_OF_PROTONS.end())},
+		ParameterGrid::Axis{"protonProtonDistance", std::vector<double>(SWEEP_PROTON_PROTON_DISTANCES.begin(), SWEEP_PROTON_PROTON_DISTANCES.end())},
+		ParameterGrid::Axis{"kineticEnergy",        std::vector<double>(ELECTRON_START_KIN_ENERGIES.begin(),   ELECTRON_START_KIN_ENERGIES.end())}});
+	constexpr int numGeometryAxes = 2;
+	const int numGeometries = grid.getNumPoints() / grid.getNumPoints(numGeometryAxes);
+	std::vector<SweepTarget> targets;
+	for(int geometryIndex = 0; geometryIndex < numGeometries; ++geometryIndex)
+	{
+		const int pointIndex = geometryIndex * grid.getNumPoints(numGeometryAxes);
+		ScatteringExperiment experiment(TargetGeometry::line(grid.getValue(pointIndex, 0), grid.getValue(pointIndex, 1), PROTON_CHARGE));
+		targets.push_back(SweepTarget{experiment, createAbsorptionClassifier(experiment)});
+	}
+	std::vector<MeasurementPointResult> pointResults(grid.getNumPoints());
+	std::unique_ptr<ResultCache> resultCache(USE_RESULT_CACHE ? new ResultCache(RESULT_CACHE_DIRECTORY) : nullptr);
+	std::vector<std::string> cacheKeys(grid.getNumPoints());
+	std::vector<WorkRange> blockRanges;
+	int numLoaded = 0;
+	for(int pointIndex = 0; pointIndex < grid.getNumPoints(); ++pointIndex)
+	{
+		if(USE_RESULT_CACHE)
+		{
+			cacheKeys[pointIndex] = measurementPointCacheKey(grid.getAxisIndex(pointIndex, numGeometryAxes), targets[grid.getSliceIndex(pointIndex, numGeometryAxes)].experiment, "sweep");
+			if(loadFromResultCache(*resultCache, cacheKeys[pointIndex], pointResults[pointIndex]))
+			{
+				++numLoaded;
+				continue;
+			}
+		}
+		pointResults[pointIndex].blockResults.resize(NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK);
+		blockRanges.push_back(WorkRange{pointIndex, 0, static_cast<int>(pointResults[pointIndex].blockResults.size())});
+	}
+	std::cout << "Parameter sweep: " << grid.getNumPoints() << " points of " << numGeometries << " geometries, " << numLoaded << " loaded from the result cache." << std::endl;
+	Pbar sweepProgress;
+	int percentPrinted = 0;
+	// Nothing is scheduled when every point was loaded from the result cache
+	if(!blockRanges.empty()) scheduler.run(blockRanges, [&grid, numGeometryAxes] (const int& pointIndex)
+	{
+		return NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(grid.getAxisIndex(pointIndex, numGeometryAxes));
+	}, [&grid, &targets, &pointResults, numGeometryAxes] (const int& pointIndex, const int& blockIndex)
+	{
+		ExperimentBlockResult blockResult; // in the memory of the worker's NUMA node
+		runSweepBlock(targets[grid.getSliceIndex(pointIndex, numGeometryAxes)], grid.getAxisIndex(pointIndex, numGeometryAxes),
+			blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, blockResult);
+		pointResults[pointIndex].blockResults[blockIndex] = std::move(blockResult);
+	}, [&sweepProgress, &percentPrinted] (const long long& numBlocksDone, const long long& numBlocksTotal)
+	{
+		const int percentDone = numBlocksDone * 100 / numBlocksTotal;
+		if(percentPrinted < percentDone)
+		{
+			sweepProgress.update(percentDone - percentPrinted);
+			percentPrinted = percentDone;
+		}
+		sweepProgress.print();
+	});
+	TFile sweepFile(PARAMETER_SWEEP_FILE_NAME, "RECREATE");
+	sweepFile.cd();
+	std::cout << "\n";
+	for(int geometryIndex = 0; geometryIndex < numGeometries; ++geometryIndex)
+	{
+		const int firstPointIndex = geometryIndex * grid.getNumPoints(numGeometryAxes);
+		TH2D matrix_H(("electronEnergyEndPositionsX_" + grid.getPointName(firstPointIndex, numGeometryAxes)).c_str(),
+			("Electron end position distribution vs starting kin. energy, " + grid.getPointName(firstPointIndex, numGeometryAxes) + ";x pos(bohr);starting kin. energy (eV)").c_str(),
+			END_POS_NUM_BINS,                      END_POS_MIN_RANGE,                                                                  END_POS_MAX_RANGE,
+			ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, ELECTRON_START_KINETIC_ENERGY_EV_MIN - 0.5 * ELECTRON_START_KINETIC_ENERGY_EV_STEP, ELECTRON_START_KINETIC_ENERGY_EV_MAX + 0.5 * ELECTRON_START_KINETIC_ENERGY_EV_STEP);
+		for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+		{
+			MeasurementPointResult& pointResult = pointResults[firstPointIndex + measurementPointIndex];
+			mergeNewBlockResults(pointResult);
+			HistogramAccumulator electronPositionsX = sumWithReplicateErrors(unfoldSymmetries(pointResult.electronPositionsXReplicates));
+			if(USE_RESULT_CACHE && pointResult.numCachedExperiments == 0) storeInResultCache(*resultCache, cacheKeys[firstPointIndex + measurementPointIndex], pointResult);
+			copyToMatrixRow(electronPositionsX, pointResult.getNumExperiments(), matrix_H, measurementPointIndex);
+			std::cout << grid.getPointName(firstPointIndex + measurementPointIndex, grid.getNumAxes()) << ": " << std::setw(8) << pointResult.totalNumUpdates / static_cast<double>(pointResult.getNumExperiments())
+				<< " updates per experiment, " << std::setw(5) << pointResult.electronsAbsorbed << " experiment fails because of electron absorbtion, relative precision "
+				<< calculateRelativePrecision(electronPositionsX) << std::endl;
+		}
+		matrix_H.Write();
+	}
+	sweepFile.Close();
+	std::cout << "Parameter sweep written to " << PARAMETER_SWEEP_FILE_NAME << "." << std::endl;
+}
+
+// A bunch of BEAM_BUNCH_NUM_ELECTRONS electrons of the energy numSetup traversing the target together. The start conditions
+// are drawn from the bunch's own random stream: x uniform over the start x range (the bunch is not mirror symmetric, the
+// whole domain is sampled), the z velocity as in electronStartPositionVelocity(), the position spread over BEAM_BUNCH_LENGTH
+// along y and BEAM_BUNCH_WIDTH along z. Every electron is finished by the end plane or the absorption test of runExperiment(),
+// absorbed electrons are not replaced. Electrons repelled back behind the start region are lost, like the ones still flying
+// after BEAM_MAX_UPDATES_FACTOR times the updates of a single electron, which end the bunch.
+void runBeamBunch(const int& numSetup, const int& bunchIndex, BeamBunchResult& result)
+{
+	const TargetGeometry target = SCATTERING_EXPERIMENT.getTarget().getNodeLocal();
+	std::vector<float> targetCharges(target.getCharges(), target.getCharges() + target.getNumCharges());
+	for(auto& targetCharge: targetCharges) targetCharge *= COULOMB_CONSTANT;
+	ElectronBunch electrons(ELECTRON_CHARGE, ELECTRON_MASS, ELECTRON_CHARGE * COULOMB_CONSTANT, target.getPositions(), targetCharges.data(), target.getNumCharges(),
+		BEAM_BUNCH_NUM_ELECTRONS, BEAM_TREE_OPENING_ANGLE, BEAM_SPACE_CHARGE);
+	std::vector<BoundStateClassifier> absorptionClassifiers(BEAM_BUNCH_NUM_ELECTRONS, createAbsorptionClassifier());
+	std::vector<std::vector<DetectorCrossing>> crossings(USE_DETECTOR_STAGE ? BEAM_BUNCH_NUM_ELECTRONS : 0);
+	// The bunch streams are flagged by the second highest bit, apart from the experiment streams
+	PhiloxRandom randomGenerator(RANDOM_SEED, 0x40000000u | numSetup, bunchIndex);
+	for(int electron = 0; electron < BEAM_BUNCH_NUM_ELECTRONS; ++electron)
+	{
+		double uniformSamples[4];
+		randomGenerator.fillUniform(uniformSamples, 4);
+		const StartConditions startConditions{static_cast<float>(ELECTRON_START_X_POS_MIN + uniformSamples[0] * (ELECTRON_START_X_POS_MAX - ELECTRON_START_X_POS_MIN)),
+			static_cast<float>(uniformSamples[1]), 1.0};
+		vec3 position, velocity;
+		electronStartPositionVelocity(numSetup, startConditions, position, velocity);
+		position += vec3(0.0f, uniformSamples[2] * BEAM_BUNCH_LENGTH, (uniformSamples[3] - 0.5) * BEAM_BUNCH_WIDTH);
+		electrons.setElectron(electron, position, velocity);
+	}
+	std::vector<vec3> previousPositions(USE_DETECTOR_STAGE ? BEAM_BUNCH_NUM_ELECTRONS : 0);
+	std::vector<vec3> previousVelocities(USE_DETECTOR_STAGE ? BEAM_BUNCH_NUM_ELECTRONS : 0);
+	const int maxNumUpdates = BEAM_MAX_UPDATES_FACTOR * expectedNumUpdatesPerExperiment(numSetup);
+	while(0 < electrons.getNumActive() && result.numUpdates < maxNumUpdates)
+	{
+		if(USE_DETECTOR_STAGE) for(const int& electron: electrons.getActiveElectrons())
+		{
+			previousPositions[electron]  = electrons.getPosition(electron);
+			previousVelocities[electron] = electrons.getVelocity(electron);
+		}
+		electrons.update(DT_STEP);
+		result.numUpdates++;
+		// Copied: finished electrons are deactivated on the way
+		const std::vector<int> activeElectrons = electrons.getActiveElectrons();
+		for(const int& electron: activeElectrons)
+		{
+			const vec3 electronPosition = electrons.getPosition(electron);
+			if(USE_DETECTOR_STAGE)
+			{
+				DETECTOR_STAGE.recordCrossings(previousPositions[electron], previousVelocities[electron], electronPosition, electrons.getVelocity(electron),
+					(result.numUpdates - 1) * DT_STEP, DT_STEP, ELECTRON_MASS, crossings[electron]);
+			}
+			const bool hit      = electronPosition.y < -ELECTRON_END_PLANE_DISTANCE;
+			// In the field of the target alone (see ElectronBunch): space charge does not make an electron look bound
+			const bool absorbed = !hit && absorptionClassifiers[electron].update(electrons.getStageTotalEnergy(electron), electronPosition, electrons.getStagePotential(electron));
+			const bool escaped  = ELECTRON_START_PLANE_DISTANCE + BEAM_BUNCH_LENGTH < electronPosition.y && 0.0f < electrons.getVelocity(electron).y;
+			if(!hit && !absorbed && !escaped) continue;
+			electrons.deactivate(electron);
+			if(absorbed || escaped)
+			{
+				(absorbed ? result.electronsAbsorbed : result.electronsLost)++;
+				continue;
+			}
+			result.electronsHit++;
+			result.electronPositionsX.fill(electronPosition.x);
+			if(USE_DETECTOR_STAGE) DETECTOR_STAGE.fill(crossings[electron], 1.0, false, false, result.observableHistograms);
+		}
+	}
+	result.electronsLost += electrons.getNumActive();
+}
+
+// BEAM_NUM_BUNCHES bunches at every measurement point, one bunch per work unit. The hit histograms of the bunches are written
+// to BEAM_BUNCHES_FILE_NAME one by one and summed, the bunches being the replicates of the error bars; the detector observables
+// likewise with USE_DETECTOR_STAGE.
+void runBeamBunches(WorkStealingScheduler& scheduler)
+{
+	std::vector<std::vector<BeamBunchResult>> bunchResults(ELECTRON_START_KIN_EN_NUM_MEAS_POINTS, std::vector<BeamBunchResult>(BEAM_NUM_BUNCHES));
+	std::vector<WorkRange> bunchRanges;
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		bunchRanges.push_back(WorkRange{measurementPointIndex, 0, BEAM_NUM_BUNCHES});
+	}
+	std::cout << "Beam bunches: " << BEAM_NUM_BUNCHES << " bunches of " << BEAM_BUNCH_NUM_ELECTRONS << " electrons per measurement point"
+		<< (BEAM_SPACE_CHARGE ? ", with" : ", without") << " space charge." << std::endl;
+	Pbar bunchProgress;
+	int percentPrinted = 0;
+	scheduler.run(bunchRanges, [] (const int& measurementPointIndex)
+	{
+		return BEAM_BUNCH_NUM_ELECTRONS * expectedNumUpdatesPerExperiment(measurementPointIndex);
+	}, [&bunchResults] (const int& measurementPointIndex, const int& bunchIndex)
+	{
+		runBeamBunch(measurementPointIndex, bunchIndex, bunchResults[measurementPointIndex][bunchIndex]);
+	}, [&bunchProgress, &percentPrinted] (const long long& numBunchesDone, const long long& numBunchesTotal)
+	{
+		const int percentDone = numBunchesDone * 100 / numBunchesTotal;
+		if(percentPrinted < percentDone)
+		{
+			bunchProgress.update(percentDone - percentPrinted);
+			percentPrinted = percentDone;
+		}
+		bunchProgress.print();
+	});
+	TFile bunchesFile(BEAM_BUNCHES_FILE_NAME, "RECREATE");
+	bunchesFile.cd();
+	std::cout << "\n";
+	for(int measurementPointIndex = 0; measurementPointIndex < ELECTRON_START_KIN_EN_NUM_MEAS_POINTS; ++measurementPointIndex)
+	{
+		const std::string pointName = std::to_string(measurementPointIndex);
+		std::vector<HistogramAccumulator> electronPositionsXBunches;
+		std::vector<std::vector<HistogramAccumulator>> observableBunches(DETECTOR_OBSERVABLES.size());
+		long long totalNumUpdates = 0;
+		int electronsHit = 0, electronsAbsorbed = 0, electronsLost = 0;
+		for(int bunchIndex = 0; bunchIndex < BEAM_NUM_BUNCHES; ++bunchIndex)
+		{
+			const BeamBunchResult& bunchResult = bunchResults[measurementPointIndex][bunchIndex];
+			const std::string bunchName = pointName + "_" + std::to_string(bunchIndex);
+			electronPositionsXBunches.push_back(bunchResult.electronPositionsX);
+			TH1D bunchPositionsX_H(("beamHitsX_" + bunchName).c_str(), ("Electron end position distribution of bunch " + bunchName + ";x pos(bohr)").c_str(),
+				END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+			bunchResult.electronPositionsX.copyToHistogram(bunchPositionsX_H);
+			bunchPositionsX_H.Write();
+			for(unsigned int observableIndex = 0; USE_DETECTOR_STAGE && observableIndex < DETECTOR_OBSERVABLES.size(); ++observableIndex)
+			{
+				const DetectorObservable& observable = DETECTOR_OBSERVABLES[observableIndex];
+				observableBunches[observableIndex].push_back(bunchResult.observableHistograms[observableIndex]);
+				TH1D observable_H((observable.name + "_" + bunchName).c_str(), (observable.name + " at " + DETECTOR_SURFACES[observable.surfaceIndex].name + ", bunch " + bunchName).c_str(),
+					observable.numBins, observable.minRange, observable.maxRange);
+				bunchResult.observableHistograms[observableIndex].copyToHistogram(observable_H);
+				observable_H.Write();
+			}
+			totalNumUpdates   += bunchResult.numUpdates;
+			electronsHit      += bunchResult.electronsHit;
+			electronsAbsorbed += bunchResult.electronsAbsorbed;
+			electronsLost     += bunchResult.electronsLost;
+		}
+		const HistogramAccumulator electronPositionsX = sumWithReplicateErrors(electronPositionsXBunches);
+		TH1D positionsX_H(("beamHitsX_" + pointName).c_str(), ("Electron end position distribution of the bunches, " + std::to_string(static_cast<int>(ELECTRON_START_KIN_ENERGIES[measurementPointIndex])) + " eV;x pos(bohr)").c_str(),
+			END_POS_NUM_BINS, END_POS_MIN_RANGE, END_POS_MAX_RANGE);
+		electronPositionsX.copyToHistogram(positionsX_H);
+		positionsX_H.Write();
+		for(unsigned int observableIndex = 0; USE_DETECTOR_STAGE && observableIndex < DETECTOR_OBSERVABLES.size(); ++observableIndex)
+		{
+			const DetectorObservable& observable = DETECTOR_OBSERVABLES[observableIndex];
+			TH1D observable_H((observable.name + "_" + pointName).c_str(), (observable.name + " at " + DETECTOR_SURFACES[observable.surfaceIndex].name + ", all bunches").c_str(),
+				observable.numBins, observable.minRange, observable.maxRange);
+			sumWithReplicateErrors(observableBunches[observableIndex]).copyToHistogram(observable_H);
+			observable_H.Write();
+		}
+		std::cout << "Measurement point " << measurementPointIndex << ": " << std::setw(8) << totalNumUpdates / static_cast<double>(BEAM_NUM_BUNCHES) << " updates per bunch, "
+			<< electronsHit << " electrons hit, " << electronsAbsorbed << " absorbed, " << electronsLost << " lost, relative precision "
+			<< calculateRelativePrecision(electronPositionsX) << std::endl;
+	}
+	bunchesFile.Close();
+	std::cout << "Beam bunches written to " << BEAM_BUNCHES_FILE_NAME << "." << std::endl;
+}
+
+// Contains calculations for the scattering processes.
+// With crossings given, the crossings of the detector surfaces are appended to it.
+const vec3 runExperiment(int& numUpdates, int& experimentSuccesful, const float& dt, std::vector<DetectorCrossing>* crossings)
+{
+	return runExperiment(SCATTERING_EXPERIMENT, createAbsorptionClassifier(), numUpdates, experimentSuccesful, dt, crossings);
+}
+// Same on another target, the experiment has to be initialized by initExperiment() with it
+const vec3 runExperiment(const ScatteringExperiment& experiment, const BoundStateClassifier& absorptionClassifierPrototype, int& numUpdates, int& experimentSuccesful,
+	const float& dt, std::vector<DetectorCrossing>* crossings)
+{
+	BoundStateClassifier absorptionClassifier = absorptionClassifierPrototype;
+	// The absorption check uses the energy cached by the last update
+	auto terminate = [&absorptionClassifier] (const ChargedParticle& electron, const int&)
+	{
+		if(electron.getPosition().y < -ELECTRON_END_PLANE_DISTANCE) return ScatteringExperiment::HIT;
+		return absorptionClassifier.update(electron) ? ScatteringExperiment::ABSORBED : ScatteringExperiment::RUNNING;
+	};
+	auto recordCrossings = [crossings, dt] (const ChargedParticle& electron, const vec3& previousPosition, const vec3& previousVelocity, const int& numUpdates)
+	{
+		DETECTOR_STAGE.recordCrossings(previousPosition, previousVelocity, electron.getPosition(), electron.getVelocity(), (numUpdates - 1) * dt, dt, ELECTRON_MASS, *crossings);
+	};
+	const ScatteringExperiment::Result result = crossings ? experiment.run(dt, terminate, recordCrossings) : experiment.run(dt, terminate);
+	numUpdates          = result.numUpdates;
+	// When the experiment is not succesful (absorbed electron): repeat it with different starting conditions
+	experimentSuccesful = result.outcome == ScatteringExperiment::HIT;
+	return result.hitPosition;
+}
+
+// The electron is tested for absorption inside the bounding box of the target charges,
+// extended by BOUND_STATE_REGION_MARGIN in every direction
+BoundStateClassifier createAbsorptionClassifier(const ScatteringExperiment& experiment)
+{
+	vec3 targetMin, targetMax;
+	experiment.getTarget().getBounds(targetMin, targetMax);
+	vec3 regionMin = targetMin - vec3(BOUND_STATE_REGION_MARGIN);
+	vec3 regionMax = targetMax + vec3(BOUND_STATE_REGION_MARGIN);
+	return BoundStateClassifier(regionMin, regionMax, BOUND_STATE_MIN_PERIAPSES);
+}
+
+// Deletes the particles kept by initExperiment() on the calling thread
+void clearExperiment()
+{
+	ScatteringExperiment::clear();
+}
+
+// Long-lived process answering the requests of bin/matrixJobClient over a Unix domain socket, until Ctrl-c:
+//   "run <number of protons> <proton-proton distance (bohr)> <kinetic energy (eV)>" runs the experiments of the parameter
+//      sweep at this point and streams the lines "queued <job>", "progress <job> <experiments done> <experiments>",
+//      "result <job> <updates per experiment> <absorbed> <relative precision> <experiments> <from cache>",
+//      "histogram <bins> <min> <max>", "bin <bin> <content> <error>" for every non-empty bin and "done <job>",
+//   "status" answers "status <queued jobs> <running jobs> <worker threads>",
+// and "error <message>" on an invalid request. The energy has to be one of the measurement points, their start velocities
+// and random streams are set up by initConsts(). The process start, the worker threads and the targets of the requested
+// geometries are shared by every request; with USE_RESULT_CACHE the results are shared with the parameter sweeps too.
+void runJobServer(WorkStealingScheduler& scheduler, const std::string& socketPath)
+{
+	UnixSocket listener = UnixSocket::listen(socketPath);
+	if(!listener.isValid())
+	{
+		std::cout << "Error: can not listen on " << socketPath << ", is another server running or is there a file that is not a socket of this user?" << std::endl;
+		return;
+	}
+	std::cout << "Job server listening on " << socketPath << " (stop with Ctrl-c)." << std::endl;
+	void (*previousInterruptHandler)(int) = std::signal(SIGINT,  requestStop);
+	void (*previousTerminateHandler)(int) = std::signal(SIGTERM, requestStop);
+	ServerJobQueue queue;
+	std::thread dispatcher(dispatchServerJobs, std::ref(scheduler), std::ref(queue));
+	int numJobsSubmitted = 0;
+	// The connections whose request line is not complete yet: they are read as their bytes arrive, a slow client does not
+	// hold up the others
+	struct PendingRequest
+	{
+		UnixSocket                            connection;
+		std::chrono::steady_clock::time_point deadline;
+	};
+	std::vector<PendingRequest> pendingRequests;
+	while(!stopRequested)
+	{
+		std::vector<const UnixSocket*> sockets(1, &listener);
+		for(const auto& pending: pendingRequests) sockets.push_back(&pending.connection);
+		const std::vector<char> readable = UnixSocket::waitReadable(sockets, 0.2);
+		const auto now = std::chrono::steady_clock::now();
+		std::vector<PendingRequest> stillPending;
+		for(unsigned int index = 0; index < pendingRequests.size(); ++index)
+		{
+			PendingRequest& pending = pendingRequests[index];
+			const bool open = !readable[index + 1] || pending.connection.receive();
+			std::string request;
+			if(pending.connection.takeLine(request)) handleServerRequest(request, pending.connection, queue, numJobsSubmitted, scheduler.size());
+			else if(JOB_SERVER_MAX_REQUEST_LENGTH < static_cast<int>(pending.connection.getNumBufferedBytes()))
+			{
+				pending.connection.writeLine("error request longer than " + std::to_string(JOB_SERVER_MAX_REQUEST_LENGTH) + " bytes");
+			}
+			else if(open && now < pending.deadline) stillPending.push_back(std::move(pending));
+		}
+		pendingRequests = std::move(stillPending);
+		if(readable[0])
+		{
+			UnixSocket connection = listener.acceptWaiting();
+			// A client that stops reading must not hold up the server: its writes fail, its job is dropped
+			connection.setNonBlocking();
+			const auto deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(JOB_SERVER_REQUEST_TIMEOUT_SECONDS));
+			if(connection.isValid()) pendingRequests.push_back(PendingRequest{std::move(connection), deadline});
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lock(queue.queueMutex);
+		queue.stopping = true;
+	}
+	queue.jobQueued.notify_all();
+	dispatcher.join();
+	std::signal(SIGINT,  previousInterruptHandler);
+	std::signal(SIGTERM, previousTerminateHandler);
+	std::cout << "Job server stopped, the clients of " << queue.jobs.size() + queue.numJobsRunning << " unfinished job(s) are disconnected." << std::endl;
+}
+
+// Answers the request line of a connection, "run" requests are queued for the dispatcher with their connection. The
+// parameters of a target are checked against the limits of the server before anything is allocated for it.
+void handleServerRequest(const std::string& request, UnixSocket& connection, ServerJobQueue& queue, int& numJobsSubmitted, const int& numWorkerThreads)
+{
+	std::istringstream requestStream(request);
+	std::string command;
+	requestStream >> command;
+	if(command == "status")
+	{
+		std::unique_lock<std::mutex> lock(queue.queueMutex);
+		connection.writeLine("status " + std::to_string(queue.jobs.size()) + " " + std::to_string(queue.numJobsRunning) + " " + std::to_string(numWorkerThreads));
+		return;
+	}
+	if(command != "run")
+	{
+		connection.writeLine("error unknown request \"" + command + "\", expected run or status");
+		return;
+	}
+	std::unique_ptr<ServerJob> job(new ServerJob());
+	float kineticEnergy = 0.0f;
+	if(!(requestStream >> job -> numberOfProtons >> job -> protonProtonDistance >> kineticEnergy))
+	{
+		connection.writeLine("error expected run <number of protons> <proton-proton distance (bohr)> <kinetic energy (eV)>");
+		return;
+	}
+	if(job -> numberOfProtons < 1 || JOB_SERVER_MAX_PROTONS < job -> numberOfProtons)
+	{
+		connection.writeLine("error the number of protons must be between 1 and " + std::to_string(JOB_SERVER_MAX_PROTONS));
+		return;
+	}
+	if(!std::isfinite(job -> protonProtonDistance) || job -> protonProtonDistance <= 0.0f || JOB_SERVER_MAX_PROTON_DISTANCE < job -> protonProtonDistance)
+	{
+		std::ostringstream message;
+		message << "error the proton-proton distance must be positive and at most " << JOB_SERVER_MAX_PROTON_DISTANCE << " bohr";
+		connection.writeLine(message.str());
+		return;
+	}
+	auto energy = std::find_if(ELECTRON_START_KIN_ENERGIES.begin(), ELECTRON_START_KIN_ENERGIES.end(), [&kineticEnergy] (const float& pointEnergy) { return std::abs(pointEnergy - kineticEnergy) < 1e-3f; });
+	if(energy == ELECTRON_START_KIN_ENERGIES.end())
+	{
+		std::ostringstream message;
+		message << "error no measurement point of " << kineticEnergy << " eV, the energies are";
+		for(const auto& pointEnergy: ELECTRON_START_KIN_ENERGIES) message << " " << pointEnergy;
+		connection.writeLine(message.str());
+		return;
+	}
+	job -> numSetup   = energy - ELECTRON_START_KIN_ENERGIES.begin();
+	job -> id         = ++numJobsSubmitted;
+	job -> connection = std::move(connection);
+	std::cout << "Job " << job -> id << ": " << job -> numberOfProtons << " protons, " << job -> protonProtonDistance << " bohr, " << *energy << " eV queued." << std::endl;
+	{
+		std::unique_lock<std::mutex> lock(queue.queueMutex);
+		job -> connection.writeLine("queued " + std::to_string(job -> id));
+		queue.jobs.push_back(std::move(job));
+	}
+	queue.jobQueued.notify_all();
+}
+
+// Runs the queued jobs on the scheduler in turns: every running job gets a slice of blocks of about the same expected cost
+// per turn, so the short jobs submitted during a long one finish in proportion to their cost. The targets of the geometries
+// are kept for the following jobs, up to JOB_SERVER_MAX_CACHED_TARGETS of them besides those of the running jobs. A job is
+// dropped when its client disconnects or stops reading.
+void dispatchServerJobs(WorkStealingScheduler& scheduler, ServerJobQueue& queue)
+{
+	struct CachedTarget
+	{
+		std::unique_ptr<SweepTarget> target;
+		long long                    lastTurnUsed = 0;
+	};
+	std::map<std::pair<int, float>, CachedTarget> targets;
+	std::unique_ptr<ResultCache> resultCache(USE_RESULT_CACHE ? new ResultCache(RESULT_CACHE_DIRECTORY) : nullptr);
+	std::vector<std::unique_ptr<ServerJob>> runningJobs;
+	for(long long turn = 1; ; ++turn)
+	{
+		{
+			std::unique_lock<std::mutex> lock(queue.queueMutex);
+			queue.numJobsRunning = runningJobs.size();
+			queue.jobQueued.wait(lock, [&queue, &runningJobs] { return queue.stopping || !queue.jobs.empty() || !runningJobs.empty(); });
+			if(queue.stopping) return;
+			for(; !queue.jobs.empty(); queue.jobs.pop_front()) runningJobs.push_back(std::move(queue.jobs.front()));
+			queue.numJobsRunning = runningJobs.size();
+		}
+		std::vector<WorkRange> blockRanges;
+		for(unsigned int jobIndex = 0; jobIndex < runningJobs.size(); ++jobIndex)
+		{
+			ServerJob& job = *runningJobs[jobIndex];
+			CachedTarget& cachedTarget = targets[std::make_pair(job.numberOfProtons, job.protonProtonDistance)];
+			cachedTarget.lastTurnUsed = turn;
+			if(!job.target)
+			{
+				if(!cachedTarget.target)
+				{
+					ScatteringExperiment experiment(TargetGeometry::line(job.numberOfProtons, job.protonProtonDistance, PROTON_CHARGE));
+					cachedTarget.target.reset(new SweepTarget{experiment, createAbsorptionClassifier(experiment)});
+				}
+				job.target = cachedTarget.target.get();
+				if(USE_RESULT_CACHE) job.cacheKey = measurementPointCacheKey(job.numSetup, job.target -> experiment, "sweep");
+				if(!USE_RESULT_CACHE || !loadFromResultCache(*resultCache, job.cacheKey, job.pointResult))
+				{
+					job.pointResult.blockResults.resize(NUM_EXPERIMENTS_PER_SETUP / NUM_EXPERIMENTS_PER_BLOCK);
+				}
+			}
+			const double blockCost = NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(job.numSetup) * job.numberOfProtons;
+			const int numBlocks = std::min(static_cast<int>(job.pointResult.blockResults.size()) - job.numBlocksScheduled,
+				std::max(1, static_cast<int>(JOB_SERVER_SLICE_PROTON_UPDATES * scheduler.size() / blockCost)));
+			if(numBlocks <= 0) continue;
+			blockRanges.push_back(WorkRange{static_cast<int>(jobIndex), job.numBlocksScheduled, job.numBlocksScheduled + numBlocks});
+			job.numBlocksScheduled += numBlocks;
+		}
+		// The targets of the running jobs were used in this turn, they are never dropped
+		while(JOB_SERVER_MAX_CACHED_TARGETS < static_cast<int>(targets.size()))
+		{
+			auto leastRecentlyUsed = targets.begin();
+			for(auto cached = targets.begin(); cached != targets.end(); ++cached)
+			{
+				if(cached -> second.lastTurnUsed < leastRecentlyUsed -> second.lastTurnUsed) leastRecentlyUsed = cached;
+			}
+			if(leastRecentlyUsed -> second.lastTurnUsed == turn) break;
+			targets.erase(leastRecentlyUsed);
+		}
+		// Nothing is scheduled when every job was loaded from the result cache
+		if(!blockRanges.empty()) scheduler.run(blockRanges, [&runningJobs] (const int& jobIndex)
+		{
+			return NUM_EXPERIMENTS_PER_BLOCK * expectedNumUpdatesPerExperiment(runningJobs[jobIndex] -> numSetup) * runningJobs[jobIndex] -> numberOfProtons;
+		}, [&runningJobs] (const int& jobIndex, const int& blockIndex)
+		{
+			ServerJob& job = *runningJobs[jobIndex];
+			ExperimentBlockResult blockResult; // in the memory of the worker's NUMA node
+			runSweepBlock(*job.target, job.numSetup, blockIndex * NUM_EXPERIMENTS_PER_BLOCK, NUM_EXPERIMENTS_PER_BLOCK, blockResult);
+			job.pointResult.blockResults[blockIndex] = std::move(blockResult);
+		}, [] (const long long&, const long long&) {});
+		for(auto& job: runningJobs)
+		{
+			const bool finished  = job -> numBlocksScheduled == static_cast<int>(job -> pointResult.blockResults.size());
+			const bool connected = job -> connection.writeLine("progress " + std::to_string(job -> id) + " " + std::to_string(job -> numBlocksScheduled * NUM_EXPERIMENTS_PER_BLOCK)
+				+ " " + std::to_string(job -> pointResult.blockResults.size() * NUM_EXPERIMENTS_PER_BLOCK));
+			if(finished) finishServerJob(*job, resultCache.get());
+			if(!connected) std::cout << "Job " << job -> id << ": client disconnected, the job is dropped." << std::endl;
+			if(finished || !connected) job.reset();
+		}
+		runningJobs.erase(std::remove(runningJobs.begin(), runningJobs.end(), nullptr), runningJobs.end());
+	}
+}
+
+// Merges the blocks of a job, stores them in the result cache and sends the results to the client
+void finishServerJob(ServerJob& job, const ResultCache* resultCache)
+{
+	MeasurementPointResult& pointResult = job.pointResult;
+	mergeNewBlockResults(pointResult);
+	const bool fromCache = 0 < pointResult.numCachedExperiments;
+	if(resultCache && !fromCache) storeInResultCache(*resultCache, job.cacheKey, pointResult);
+	const HistogramAccumulator electronPositionsX = sumWithReplicateErrors(unfoldSymmetries(pointResult.electronPositionsXReplicates));
+	const double relativePrecision = calculateRelativePrecision(electronPositionsX);
+	std::ostringstream result;
+	result << std::setprecision(9) << "result " << job.id << " " << pointResult.totalNumUpdates / static_cast<double>(pointResult.getNumExperiments()) << " " << pointResult.electronsAbsorbed
+		<< " " << relativePrecision << " " << pointResult.getNumExperiments() << " " << fromCache;
+	result << "\nhistogram " << electronPositionsX.getNumBins() << " " << electronPositionsX.getMinRange() << " " << electronPositionsX.getMaxRange();
+	for(int bin = 0; bin < electronPositionsX.getNumBins() + 2; ++bin)
+	{
+		if(electronPositionsX.getBinContent(bin) != 0.0) result << "\nbin " << bin << " " << electronPositionsX.getBinContent(bin) << " " << electronPositionsX.getBinError(bin);
+	}
+	result << "\ndone " << job.id;
+	job.connection.writeLine(result.str());
+	std::cout << "Job " << job.id << " done" << (fromCache ? " (from the result cache)" : "") << ", relative precision " << relativePrecision << "." << std::endl;
 }
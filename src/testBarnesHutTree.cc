@@ -0,0 +1,78 @@
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../interface/PhiloxRandom.h"
+#include "../interface/BarnesHutTree.h"
+
+using glm::vec3;
+
+// Compares the fields of a BarnesHutTree with the opening angle 1 against the direct sum (opening angle 0), on a
+// uniform cloud of charges and on a dense cluster with a few charges in the opposite corner of the root cell. In the
+// latter the root cell is seen under less than the opening angle from the leaves of the corner, it must be opened
+// nevertheless because it contains them: the fields of the corner charges are checked.
+
+constexpr float OPENING_ANGLE       = 1.0f;
+constexpr float MAX_RELATIVE_ERROR  = 0.05f; // of the fields of all charges together
+constexpr int   NUM_CLOUD_CHARGES   = 2000;
+constexpr int   NUM_CLUSTER_CHARGES = 1000;
+constexpr int   NUM_CORNER_CHARGES  = 20;
+
+vec3 randomPosition(PhiloxRandom& randomGenerator, const vec3& low, const float& size)
+{
+	const float x = randomGenerator.uniform();
+	const float y = randomGenerator.uniform();
+	const float z = randomGenerator.uniform();
+	return low + size * vec3(x, y, z);
+}
+
+// Root mean square of the deviations of the fields of the charges from firstChecked on, relative to the root mean square
+// of their direct fields
+float relativeError(const std::vector<vec3>& positions, const int& firstChecked)
+{
+	const std::vector<float> charges(positions.size(), 1.0f);
+	BarnesHutTree directTree(0.0f);
+	BarnesHutTree tree(OPENING_ANGLE);
+	directTree.build(positions.data(), charges.data(), positions.size());
+	tree.build(positions.data(), charges.data(), positions.size());
+	std::vector<vec3> directPotentials;
+	std::vector<vec3> potentials;
+	directTree.calculatePotentials(directPotentials);
+	tree.calculatePotentials(potentials);
+	double sumDeviationSquares = 0.0;
+	double sumDirectSquares    = 0.0;
+	for(unsigned int index = firstChecked; index < positions.size(); ++index)
+	{
+		const vec3 deviation = potentials[index] - directPotentials[index];
+		sumDeviationSquares += glm::dot(deviation, deviation);
+		sumDirectSquares    += glm::dot(directPotentials[index], directPotentials[index]);
+	}
+	return std::sqrt(sumDeviationSquares / sumDirectSquares);
+}
+
+int main()
+{
+	PhiloxRandom randomGenerator(12345, 0, 0);
+	std::vector<vec3> cloud;
+	for(int index = 0; index < NUM_CLOUD_CHARGES; ++index) cloud.push_back(randomPosition(randomGenerator, vec3(0, 0, 0), 1.0f));
+	std::vector<vec3> clusterAndCorner;
+	for(int index = 0; index < NUM_CLUSTER_CHARGES; ++index) clusterAndCorner.push_back(randomPosition(randomGenerator, vec3(0, 0, 0), 0.01f));
+	for(int index = 0; index < NUM_CORNER_CHARGES;  ++index) clusterAndCorner.push_back(randomPosition(randomGenerator, vec3(0.9f, 0.9f, 0.9f), 0.1f));
+	int numFailures = 0;
+	std::cout << std::scientific << std::setprecision(3);
+	const float cloudError  = relativeError(cloud, 0);
+	const float cornerError = relativeError(clusterAndCorner, NUM_CLUSTER_CHARGES);
+	std::cout << "uniform cloud:                   relative error " << cloudError  << "\n";
+	std::cout << "corner charges beside a cluster: relative error " << cornerError << "\n";
+	numFailures += !(cloudError < MAX_RELATIVE_ERROR);
+	numFailures += !(cornerError < MAX_RELATIVE_ERROR);
+	if(numFailures)
+	{
+		std::cout << "Failed: " << numFailures << " case(s) deviate from the direct sum by more than " << MAX_RELATIVE_ERROR << "." << std::endl;
+		return 1;
+	}
+	std::cout << "Succesful: the fields of the tree agree with the direct sum." << std::endl;
+	return 0;
+}
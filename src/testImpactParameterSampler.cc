@@ -0,0 +1,88 @@
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "../interface/PhiloxRandom.h"
+#include "../interface/HistogramAccumulator.h"
+#include "../interface/ImpactParameterSampler.h"
+
+// Compares the hit distribution of stratified, antithetic, importance sampled experiments with repeated
+// absorbed experiments against plain Monte Carlo, on a model target whose absorption depends strongly on
+// the stratum: start positions below 0.5 are absorbed with probability 0.9, the rest never. The hit of an
+// experiment that is not absorbed is its start position.
+
+constexpr int    NUM_SLOTS      = 100;
+constexpr int    NUM_STRATA     = 10;
+constexpr int    NUM_REPLICATES = 400;
+constexpr int    NUM_BINS       = 10;
+constexpr double MAX_DEVIATION  = 4.0; // in standard deviations
+
+double absorptionProbability(const double& x)
+{
+	return x < 0.5 ? 0.9 : 0.0;
+}
+
+// Probability of a hit in the bin of the experiments that are not absorbed
+double exactBinProbability(const int& bin)
+{
+	const double acceptedLow  = 0.5 * (1.0 - absorptionProbability(0.25));
+	const double acceptedHigh = 0.5 * (1.0 - absorptionProbability(0.75));
+	const double binWidth = 1.0 / NUM_BINS;
+	const double binCenter = (bin - 0.5) * binWidth;
+	return binWidth * (1.0 - absorptionProbability(binCenter)) / (acceptedLow + acceptedHigh);
+}
+
+std::vector<HistogramAccumulator> runReplicates(const ImpactParameterSampler& sampler, const std::uint32_t& stream)
+{
+	std::vector<HistogramAccumulator> replicates(NUM_REPLICATES, HistogramAccumulator(NUM_BINS, 0.0, 1.0));
+	for(int replicate = 0; replicate < NUM_REPLICATES; ++replicate)
+	{
+		for(int slot = 0; slot < NUM_SLOTS; ++slot)
+		{
+			PhiloxRandom randomGenerator(12345, stream, replicate * NUM_SLOTS + slot);
+			// The antithetic partner uses the number of the first experiment of its pair
+			PhiloxRandom sourceRandomGenerator(12345, stream, replicate * NUM_SLOTS + sampler.randomNumberSourceSlot(slot));
+			ImpactParameterSampler::Sample sample = sampler.sample(sourceRandomGenerator.uniform(), slot);
+			if(sampler.randomNumberSourceSlot(slot) == slot) randomGenerator = sourceRandomGenerator;
+			while(randomGenerator.uniform() < absorptionProbability(sample.x))
+			{
+				sample = sampler.retry(randomGenerator.uniform(), sample.weight);
+			}
+			replicates[replicate].fill(sample.x, sample.weight);
+		}
+	}
+	return replicates;
+}
+
+int main()
+{
+	const ImpactParameterSampler plainSampler(0.0, 1.0, NUM_SLOTS, 1, 0);
+	const ImpactParameterSampler variedSampler(0.0, 1.0, NUM_SLOTS, NUM_STRATA, 1, [] (const double& x) { return 1.0 + 4.0 * x; });
+	const HistogramAccumulator plain  = sumWithReplicateErrors(runReplicates(plainSampler, 0));
+	const HistogramAccumulator varied = sumWithReplicateErrors(runReplicates(variedSampler, 1));
+	const double numExperiments = static_cast<double>(NUM_SLOTS) * NUM_REPLICATES;
+	int numFailures = 0;
+	std::cout << std::fixed << std::setprecision(5);
+	std::cout << " bin       exact       plain      varied   deviation (plain)   deviation (exact)\n";
+	for(int bin = 1; bin <= NUM_BINS; ++bin)
+	{
+		const double exact = exactBinProbability(bin);
+		const double plainFraction  = plain.getBinContent(bin)  / numExperiments;
+		const double variedFraction = varied.getBinContent(bin) / numExperiments;
+		const double plainError  = plain.getBinError(bin)  / numExperiments;
+		const double variedError = varied.getBinError(bin) / numExperiments;
+		const double deviationFromPlain = (variedFraction - plainFraction) / std::sqrt(plainError * plainError + variedError * variedError);
+		const double deviationFromExact = (variedFraction - exact) / variedError;
+		std::cout << std::setw(4) << bin << std::setw(12) << exact << std::setw(12) << plainFraction << std::setw(12) << variedFraction
+			<< std::setw(20) << deviationFromPlain << std::setw(20) << deviationFromExact << "\n";
+		numFailures += MAX_DEVIATION < std::abs(deviationFromPlain) || MAX_DEVIATION < std::abs(deviationFromExact);
+	}
+	if(numFailures)
+	{
+		std::cout << "Failed: " << numFailures << " bin(s) deviate by more than " << MAX_DEVIATION << " standard deviations." << std::endl;
+		return 1;
+	}
+	std::cout << "Succesful: the stratified, antithetic and importance sampled estimate agrees with plain Monte Carlo." << std::endl;
+	return 0;
+}
@@ -15,8 +15,7 @@
 #include <TApplication.h>
 #include <TCanvas.h>
 
-#include "../interface/Electron.h"
-#include "../interface/Proton.h"
+#include "../interface/ScatteringExperiment.h"
 
 #include "../interface/HelperFunctionsCommon.h"
 
@@ -26,13 +25,13 @@ using glm::vec3;
 const float DT_STEP = 1.0e-14f;
 const float HIDROGEN_PROTON_DISTANCE = 7.4e-11;
 
+// Two fixed protons
+const ScatteringExperiment SCATTERING_EXPERIMENT({vec3(-HIDROGEN_PROTON_DISTANCE, 0, 0), vec3(+HIDROGEN_PROTON_DISTANCE, 0, 0)});
+
 // Function declarations
-void setProtonPositions();
-void setElectronStartPositionVelocity();
+vec3        electronStartPosition();
 void        initExperiment();
-// void        calculateForces();
-// void        updateParticles(const float& dt);
-const vec3& runExperiment();
+const vec3  runExperiment();
 void        clearExperiment();
 
 int main(int argc, char **argv)
@@ -44,9 +43,9 @@ int main(int argc, char **argv)
 	{
 		initExperiment();
 		vec3 electronHitPosition = runExperiment();
-		clearExperiment();
 		electronPositionsX.Fill(electronHitPosition.x);
 	}
+	clearExperiment();
 	TCanvas canvas;
 	canvas.cd();
 	electronPositionsX.Draw();
@@ -54,27 +53,14 @@ int main(int argc, char **argv)
 	return 0;
 }
 
-void setProtonPositions()
-{
-	auto& proton_1 = ChargedParticle::chargedParticleCollection[0];
-	auto& proton_2 = ChargedParticle::chargedParticleCollection[1];
-	proton_1 -> setPosition(vec3(-HIDROGEN_PROTON_DISTANCE, 0, 0));
-	proton_2 -> setPosition(vec3(+HIDROGEN_PROTON_DISTANCE, 0, 0));
-}
-
-void setElectronStartPositionVelocity()
+// Beam source: electron at rest above the protons at a random x
+vec3 electronStartPosition()
 {
-	auto& electron = ChargedParticle::chargedParticleCollection[2];
 	float x, y, z;
-	float vx, vy, vz;
 	x = rand() / static_cast<double>(RAND_MAX) * HIDROGEN_PROTON_DISTANCE - 0.5f * HIDROGEN_PROTON_DISTANCE;
 	y = HIDROGEN_PROTON_DISTANCE * 2;
 	z = 0;
-	vx = 0;
-	vy = 0;
-	vz = 0;
-	electron -> setPosition(vec3( x,  y,  z));
-	electron -> setVelocity(vec3(vx, vy, vz));
+	return vec3(x, y, z);
 }
 
 // Initialize an experiment setup:
@@ -82,58 +68,17 @@ void setElectronStartPositionVelocity()
 // with randomized velocity and position
 void initExperiment()
 {
-	new Proton();
-	new Proton();
-	new Electron();
-	setProtonPositions();
-	setElectronStartPositionVelocity();
+	SCATTERING_EXPERIMENT.init(electronStartPosition(), vec3(0, 0, 0));
 }
 
-// Calculate forces before uptdating the particles
-// void calculateForces()
-// {
-// 	// Electrostatically interacting particles
-// 	for(auto& chargedParticle: ChargedParticle::chargedParticleCollection)
-// 	{
-// 		chargedParticle -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-// 	}
-// }
-
-// Update particle positions, velocities
-// void updateParticles(const float& dt)
-// {
-// 	// Electrostatically interacting particles
-// 	for(const auto& particle: ChargedParticle::chargedParticleCollection)
-// 	{
-// 		particle -> update(dt);
-// 	}
-// }
-
 // Contains calculations for the scattering processes
-const vec3& runExperiment()
+const vec3 runExperiment()
 {
-	// int i = 0;
-	while(1)
-	{
-		auto& electron = ChargedParticle::chargedParticleCollection[2];
-		// calculateForces();
-		// updateParticles(DT_STEP);
-		electron -> calculateForceFromChargedParticleCollection(ChargedParticle::chargedParticleCollection);
-		electron -> update(DT_STEP);
-		const vec3& electronPosition = electron -> getPosition();
-		// std::cout << "Electron y: " << electronPosition.y() << std::endl;
-		if(electronPosition.y < -HIDROGEN_PROTON_DISTANCE)
-		{
-			// std::cout << i << std::endl;
-			return electronPosition;
-		}
-		// ++i;
-	}
+	return SCATTERING_EXPERIMENT.run(DT_STEP, ScatteringExperiment::EndPlaneTermination{-HIDROGEN_PROTON_DISTANCE}).hitPosition;
 }
 
 // Deletes particles in the experiment
 void clearExperiment()
 {
-	Particle::particleCollection.clear();
-	ChargedParticle::chargedParticleCollection.clear();
+	ScatteringExperiment::clear();
 }